@@ -0,0 +1,18 @@
+// Link this file into a program to count heap allocations per job: it
+// replaces the global operator new with one that reports every allocation
+// to countAllocation() (see resource_usage.h). Without it, allocated bytes
+// in status() stay zero.
+#include "resource_usage.h"
+#include <cstdlib>
+#include <new>
+
+void *operator new(std::size_t size) {
+  countAllocation(size);
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
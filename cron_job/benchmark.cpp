@@ -0,0 +1,912 @@
+#include "cron_job_manager.h"
+#include "process_pool.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+static double processCpuMs() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+template <typename F> static double timeNs(F &&f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - begin)
+      .count();
+}
+
+// CPU burnt by a started manager whose jobs are all far from due.
+static void benchIdleCpu(int jobs) {
+  // Histograms for 1M jobs would take 3 GB.
+  CronJobManager::Options options;
+  options.latencies = false;
+  CronJobManager manager(options);
+  std::mt19937 gen(jobs);
+  std::uniform_int_distribution<> interval(3600, 7200);
+  for (int i = 0; i < jobs; ++i) {
+    manager.addJob("job " + std::to_string(i), []() {}, interval(gen));
+  }
+
+  manager.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  double before = processCpuMs();
+  auto wakeups = manager.schedulerWakeups();
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+  double idle = processCpuMs() - before;
+  wakeups = manager.schedulerWakeups() - wakeups;
+  manager.stop();
+
+  std::printf("  idle cpu over 2s:            %10.3f ms\n", idle);
+  std::printf("  scheduler wakeups over 2s:   %10llu\n",
+              static_cast<unsigned long long>(wakeups));
+}
+
+// Cost of expiring one due job from the timer wheel and re-arming it,
+// compared with the per-second full scan the manager used to do.
+static void benchDispatch(int jobs) {
+  std::mt19937 gen(jobs);
+  std::uniform_int_distribution<> interval(1, 3600);
+
+  SteadyClock clock;
+  std::vector<std::unique_ptr<CronJob>> storage;
+  TimerWheel<CronJob *> schedule;
+  for (int i = 0; i < jobs; ++i) {
+    storage.emplace_back(std::make_unique<CronJob>(
+        "job " + std::to_string(i), []() {},
+        std::chrono::seconds(interval(gen)), clock));
+    schedule.insert(storage.back()->interval.count(), storage.back().get());
+  }
+
+  const int rounds = 100000;
+  int fired = 0;
+  double dispatch = timeNs([&]() {
+    while (fired < rounds) {
+      schedule.advance(schedule.nextTick(), [&](CronJob *job) {
+        ++fired;
+        schedule.insert(schedule.now() + job->interval.count(), job);
+      });
+    }
+  });
+
+  auto now = std::chrono::steady_clock::now();
+  int due = 0;
+  double scan = timeNs([&]() {
+    for (auto &job : storage) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+                         now - job->last_run)
+                         .count();
+      if (!job->in_flight &&
+          elapsed >= std::chrono::duration_cast<std::chrono::seconds>(
+                         job->interval)
+                         .count()) {
+        ++due;
+      }
+    }
+  });
+
+  std::printf("  wheel dispatch per due job:  %10.1f ns\n", dispatch / fired);
+  std::printf("  full scan per tick (old):    %10.1f us  (%d due)\n",
+              scan / 1e3, due);
+}
+
+// Per-job cost of a pass over every job's run state: the job table's
+// contiguous state arrays against the old layout, with the state inside
+// each heap-allocated job and the jobs behind pointers in a vector.
+static void benchScan(int jobs) {
+  struct OldJob {
+    std::string name;
+    std::function<void()> task;
+    std::chrono::milliseconds interval;
+    JobState state;
+    std::chrono::steady_clock::time_point last_run;
+    std::chrono::steady_clock::time_point next_due;
+  };
+  std::vector<std::unique_ptr<OldJob>> old;
+  for (int i = 0; i < jobs; ++i) {
+    old.emplace_back(std::make_unique<OldJob>());
+    old.back()->name = "job " + std::to_string(i);
+  }
+  // Jobs come and go, so neighbours in the vector are rarely neighbours in
+  // memory.
+  std::shuffle(old.begin(), old.end(), std::mt19937(jobs));
+
+  CronJobManager::Options options;
+  options.workers = 2;
+  options.latencies = false;
+  CronJobManager manager(options);
+  for (int i = 0; i < jobs; ++i) {
+    manager.addJob("job " + std::to_string(i), []() {}, 3600);
+  }
+
+  const int passes = 5;
+  std::size_t seen = 0;
+  double pointers = timeNs([&]() {
+    for (int pass = 0; pass < passes; ++pass) {
+      for (auto &job : old) {
+        seen += job->state.running() + job->state.paused() +
+                (job->state.nextDue() < job->next_due);
+      }
+    }
+  });
+  double arrays = timeNs([&]() {
+    for (int pass = 0; pass < passes; ++pass) {
+      seen += manager.summary().jobs;
+    }
+  });
+
+  std::printf("  state scan, job pointers:    %10.2f ns/job\n",
+              pointers / passes / jobs);
+  std::printf("  state scan, table arrays:    %10.2f ns/job  (%zu)\n",
+              arrays / passes / jobs, seen);
+}
+
+// Lateness of actual fire times against the schedule for millisecond jobs.
+// Each job's schedule is anchored at its registration time.
+static void benchJitter() {
+  using clock = std::chrono::steady_clock;
+  const std::vector<int> intervals_ms = {50, 75, 100, 150, 250, 500};
+  const int copies = 4;
+
+  struct Record {
+    clock::time_point expected;
+    std::chrono::milliseconds interval;
+    std::vector<double> lateness_us;
+  };
+  std::vector<Record> records(intervals_ms.size() * copies);
+
+  CronJobManager manager;
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    Record &record = records[i];
+    record.interval = std::chrono::milliseconds(intervals_ms[i / copies]);
+    record.lateness_us.reserve(1024);
+    record.expected = clock::now() + record.interval;
+    manager.addJob(
+        "jitter " + std::to_string(i),
+        [&record]() {
+          auto late = clock::now() - record.expected;
+          record.lateness_us.push_back(
+              std::chrono::duration<double, std::micro>(late).count());
+          record.expected += record.interval;
+        },
+        record.interval);
+  }
+  manager.start();
+  std::this_thread::sleep_for(std::chrono::seconds(3));
+  manager.stop();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::printf("jitter over 3s (scheduled vs actual fire time)\n");
+  std::printf("  %8s %6s %10s %10s %10s %10s\n", "interval", "fires",
+              "p50 us", "p99 us", "max us", "min us");
+  for (std::size_t i = 0; i < intervals_ms.size(); ++i) {
+    std::vector<double> all;
+    for (int c = 0; c < copies; ++c) {
+      auto &samples = records[i * copies + c].lateness_us;
+      all.insert(all.end(), samples.begin(), samples.end());
+    }
+    if (all.empty()) {
+      continue;
+    }
+    std::sort(all.begin(), all.end());
+    std::printf("  %6d ms %6zu %10.1f %10.1f %10.1f %10.1f\n",
+                intervals_ms[i], all.size(), all[all.size() / 2],
+                all[all.size() * 99 / 100], all.back(), all.front());
+  }
+}
+
+// Firings per second when every run gets its own detached thread, as the
+// manager used to do, versus handing runs to the bounded executor.
+static void benchFiring() {
+  const int firings = 20000;
+  std::atomic<int> done{0};
+  auto task = [&done]() { done.fetch_add(1, std::memory_order_relaxed); };
+
+  double detached = timeNs([&]() {
+    for (int i = 0; i < firings; ++i) {
+      std::thread(task).detach();
+    }
+    while (done.load() < firings) {
+      std::this_thread::yield();
+    }
+  });
+
+  std::printf("firing throughput (%d trivial runs)\n", firings);
+  std::printf("  thread per run:              %10.0f runs/s\n",
+              firings / (detached / 1e9));
+
+  for (std::size_t workers : {1, 4, 16}) {
+    done = 0;
+    Executor executor(workers);
+    double pooled = timeNs([&]() {
+      for (int i = 0; i < firings; ++i) {
+        executor.submit(task);
+      }
+      while (done.load() < firings) {
+        std::this_thread::yield();
+      }
+    });
+    auto stats = executor.stats();
+    std::printf("  executor, %2zu workers:       %10.0f runs/s  "
+                "(avg wait %.1f us, max %.1f us)\n",
+                workers, firings / (pooled / 1e9),
+                stats.total_queue_wait.count() / 1e3 / stats.started,
+                stats.max_queue_wait.count() / 1e3);
+  }
+}
+
+// Parse and next-fire cost for 1M random cron expressions, with a
+// minute-by-minute search over a sample of them for comparison.
+static void benchCronNext() {
+  const int count = 1000000;
+  std::mt19937 gen(42);
+  auto pick = [&gen](int low, int high) {
+    return std::uniform_int_distribution<>(low, high)(gen);
+  };
+  auto field = [&](int low, int high) -> std::string {
+    switch (pick(0, 4)) {
+    case 0:
+      return "*";
+    case 1:
+      return "*/" + std::to_string(pick(2, 15));
+    case 2: {
+      int a = pick(low, high);
+      return std::to_string(a) + "-" + std::to_string(pick(a, high));
+    }
+    case 3:
+      return std::to_string(pick(low, high)) + "," +
+             std::to_string(pick(low, high));
+    default:
+      return std::to_string(pick(low, high));
+    }
+  };
+
+  std::vector<std::string> expressions;
+  expressions.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    expressions.push_back(field(0, 59) + " " + field(0, 23) + " " +
+                          field(1, 28) + " " + field(1, 12) + " " +
+                          field(0, 6));
+  }
+
+  std::vector<CronSchedule> schedules;
+  schedules.reserve(count);
+  double parse = timeNs([&]() {
+    for (const auto &expression : expressions) {
+      schedules.push_back(*CronSchedule::parse(expression));
+    }
+  });
+
+  auto from = std::chrono::system_clock::now();
+  std::uint64_t checksum = 0;
+  double next = timeNs([&]() {
+    for (const auto &schedule : schedules) {
+      checksum += schedule.next(from).time_since_epoch().count();
+    }
+  });
+
+  // Stepping minute by minute, capped at a year per expression.
+  const int sampled = 1000;
+  double stepped = timeNs([&]() {
+    for (int i = 0; i < sampled; ++i) {
+      auto t = std::chrono::ceil<std::chrono::minutes>(from);
+      for (int step = 0; step < 525600 && !schedules[i].matches(t); ++step) {
+        t += std::chrono::minutes(1);
+      }
+      checksum += t.time_since_epoch().count();
+    }
+  });
+
+  std::printf("cron expressions (%d)\n", count);
+  std::printf("  parse:                       %10.1f ns/expr\n",
+              parse / count);
+  std::printf("  next fire (bit scans):       %10.1f ns/expr\n", next / count);
+  std::printf("  next fire (minute steps):    %10.1f ns/expr  (%d sampled)\n",
+              stepped / sampled, sampled);
+  std::printf("  checksum %llu\n", static_cast<unsigned long long>(checksum));
+
+  // Known fire times after midnight UTC on Monday 2024-01-01. A day field
+  // starting with `*` narrows the other one; two restricted fields widen.
+  using std::chrono::year;
+  const std::chrono::sys_days monday = year(2024) / 1 / 1;
+  const struct {
+    const char *expression;
+    std::chrono::sys_days expected;
+  } known[] = {
+      {"0 0 */2 * *", year(2024) / 1 / 3},
+      {"0 0 */10 * MON", year(2024) / 3 / 11},
+      {"0 0 * * MON", year(2024) / 1 / 8},
+      {"0 0 13 * FRI", year(2024) / 1 / 5},
+      {"0 0 1 * *", year(2024) / 2 / 1},
+  };
+  for (const auto &check : known) {
+    auto fire = CronSchedule::parse(check.expression)->next(monday);
+    std::printf("  %-16s next fire %s\n", check.expression,
+                fire == check.expected ? "ok" : "WRONG");
+  }
+}
+
+// Thousands of coroutine jobs that mostly sleep, sharing two workers.
+static void benchCoroutines() {
+  const int jobs = 10000;
+  std::atomic<int> finished{0};
+  CronJobManager manager(2);
+  for (int i = 0; i < jobs; ++i) {
+    manager.addJob(
+        "waiting " + std::to_string(i),
+        [&manager, &finished]() -> CronTask {
+          for (int step = 0; step < 3; ++step) {
+            co_await manager.sleep(std::chrono::milliseconds(200));
+          }
+          finished.fetch_add(1, std::memory_order_relaxed);
+        },
+        std::chrono::milliseconds(500 + i % 500));
+  }
+
+  double before = processCpuMs();
+  manager.start();
+  std::this_thread::sleep_for(std::chrono::seconds(3));
+  double cpu = processCpuMs() - before;
+  auto status = manager.status();
+  std::size_t waiting = 0;
+  for (const auto &job : status) {
+    waiting += job.running;
+  }
+  manager.stop();
+
+  std::printf("coroutine jobs (%d, 2 workers, 3 x 200 ms sleeps per run)\n",
+              jobs);
+  std::printf("  runs finished in 3s:         %10d\n", finished.load());
+  std::printf("  runs suspended at the end:   %10zu\n", waiting);
+  std::printf("  cpu used:                    %10.1f ms\n", cpu);
+
+  // A run parked in sleep() across stop() and start(), in virtual time: it
+  // must be closed by stop() and the job must run again after start().
+  ManualClock clock;
+  CronJobManager::Options options;
+  options.workers = 1;
+  options.clock = &clock;
+  CronJobManager restarted(options);
+  int started = 0;
+  restarted.addJob(
+      "nap",
+      [&restarted, &started]() -> CronTask {
+        ++started;
+        co_await restarted.sleep(std::chrono::minutes(10));
+      },
+      std::chrono::minutes(1));
+  auto running = [&restarted]() {
+    std::size_t count = 0;
+    for (const auto &job : restarted.status()) {
+      count += job.running;
+    }
+    return count;
+  };
+  restarted.start();
+  restarted.advance(std::chrono::seconds(90));
+  restarted.stop();
+  std::size_t after_stop = running();
+  restarted.start();
+  restarted.advance(std::chrono::minutes(2));
+  restarted.stop();
+  std::printf("  parked across a restart:     %s\n",
+              started == 2 && after_stop == 0 && running() == 0 ? "ok"
+                                                                 : "WRONG");
+}
+
+// Queueing delay per priority class when due runs outnumber the workers, and
+// the peak concurrency of a group limited to two.
+static void benchPriorities() {
+  const int jobs = 300;
+  std::atomic<int> db_running{0};
+  std::atomic<int> db_peak{0};
+  CronJobManager manager(2);
+  manager.setConcurrencyLimit("db", 2);
+  auto busy = []() {
+    auto until = std::chrono::steady_clock::now() +
+                 std::chrono::microseconds(200);
+    while (std::chrono::steady_clock::now() < until) {
+    }
+  };
+  for (int i = 0; i < jobs; ++i) {
+    JobOptions options;
+    options.priority = static_cast<Priority>(i % PRIORITIES);
+    if (i % 10 == 0) {
+      options.group = "db";
+    }
+    manager.addJob(
+        "job " + std::to_string(i),
+        [&, group = !options.group.empty()]() {
+          if (group) {
+            int now = db_running.fetch_add(1) + 1;
+            int peak = db_peak.load();
+            while (now > peak && !db_peak.compare_exchange_weak(peak, now)) {
+            }
+          }
+          busy();
+          if (group) {
+            db_running.fetch_sub(1);
+          }
+        },
+        std::chrono::milliseconds(50), options);
+  }
+  manager.start();
+  std::this_thread::sleep_for(std::chrono::seconds(3));
+  manager.stop();
+
+  static const char *const names[] = {"high", "normal", "low"};
+  std::printf("priority classes (%d jobs every 50 ms, 200 us each, 2 "
+              "workers)\n",
+              jobs);
+  for (const auto &c : manager.classLatencies()) {
+    std::printf("  %-6s queueing delay p50/p99:  %8.2f / %8.2f ms\n",
+                names[static_cast<int>(c.priority)],
+                c.queue_delay.quantile(0.5).count() / 1e3,
+                c.queue_delay.quantile(0.99).count() / 1e3);
+  }
+  std::printf("  peak concurrent db runs:     %10d (limit 2)\n",
+              db_peak.load());
+}
+
+// Fires per 100 ms bucket of a 1 s interval for 500 jobs sharing it:
+// counting from when they were added, with name-derived phases, and with
+// phases plus a 100 ms random splay.
+static void benchSpread() {
+  const int jobs = 500;
+  std::printf("fires per 100 ms bucket (%d jobs every 1 s, 3 s)\n", jobs);
+  std::printf("  %-16s", "");
+  for (int b = 0; b < 10; ++b) {
+    std::printf("%6d", b * 100);
+  }
+  std::printf("\n");
+  for (int mode = 0; mode < 3; ++mode) {
+    std::array<std::atomic<int>, 10> buckets{};
+    JobOptions options;
+    options.spread = mode > 0;
+    options.splay = std::chrono::milliseconds(mode == 2 ? 100 : 0);
+    CronJobManager manager(4);
+    for (int i = 0; i < jobs; ++i) {
+      manager.addJob(
+          "spread " + std::to_string(i),
+          [&buckets]() {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+            buckets[ms % 1000 / 100].fetch_add(1, std::memory_order_relaxed);
+          },
+          std::chrono::seconds(1), options);
+    }
+    manager.start();
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+    manager.stop();
+
+    static const char *const names[] = {"from add", "phased", "phased+splay"};
+    std::printf("  %-16s", names[mode]);
+    for (auto &bucket : buckets) {
+      std::printf("%6d", bucket.load());
+    }
+    std::printf("\n");
+  }
+}
+
+// One trigger of an extract -> 8 x compress -> publish graph on 4 workers:
+// wall time against the critical path and the sum of all node durations.
+static void benchGraph() {
+  auto sleepMs = [](int ms) {
+    return [ms]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    };
+  };
+  JobGraph graph;
+  auto extract = graph.add("extract", sleepMs(10));
+  std::vector<JobGraph::NodeId> parts;
+  for (int i = 0; i < 8; ++i) {
+    parts.push_back(
+        graph.add("compress " + std::to_string(i), sleepMs(20 + i), {extract}));
+  }
+  graph.add("publish", sleepMs(5), parts);
+
+  Executor executor(4);
+  TaskGroup trigger(executor);
+  trigger.spawn([&graph]() { graph.run(); });
+  trigger.wait();
+
+  GraphRun run = graph.lastRun();
+  std::chrono::nanoseconds total{0};
+  for (const auto &node : run.nodes) {
+    total += node.duration;
+  }
+  auto ms = [](std::chrono::nanoseconds ns) { return ns.count() / 1e6; };
+  std::printf("job graph (10 nodes, 8 parallel, 4 workers)\n");
+  std::printf("  wall time:                   %10.2f ms\n", ms(run.wall));
+  std::printf("  critical path:               %10.2f ms  (",
+              ms(run.critical_path));
+  for (std::size_t i = 0; i < run.path.size(); ++i) {
+    std::printf("%s%s", i ? " -> " : "", run.path[i].c_str());
+  }
+  std::printf(")\n");
+  std::printf("  sum of node durations:       %10.2f ms\n", ms(total));
+
+  // A child that throws on another worker: the parent keeps its worker busy
+  // until the child has been stolen, and wait() must rethrow there.
+  std::atomic<bool> stolen{false};
+  bool rethrown = false;
+  trigger.spawn([&stolen, &rethrown]() {
+    TaskGroup children;
+    children.spawn([&stolen]() {
+      stolen = true;
+      throw std::runtime_error("child failed");
+    });
+    while (!stolen) {
+      std::this_thread::yield();
+    }
+    try {
+      children.wait();
+    } catch (const std::runtime_error &) {
+      rethrown = true;
+    }
+  });
+  trigger.wait();
+  std::printf("  stolen child throws:         %s\n",
+              rethrown ? "ok" : "WRONG");
+}
+
+// Dispatch rate of 1 ms jobs as the scheduler is split into more shards.
+// Workers are sized to the host so the scheduler threads are the limit.
+static void benchShards() {
+  const int jobs = 20000;
+  unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+  std::printf("sharded dispatch (%d jobs every 1 ms, %u workers, pinned)\n",
+              jobs, cpus);
+  for (std::size_t shards : {1, 2, 4, 8, 16, 32}) {
+    CronJobManager::Options options;
+    options.workers = cpus;
+    options.shards = shards;
+    options.pin_shards = true;
+    CronJobManager manager(options);
+    for (int i = 0; i < jobs; ++i) {
+      manager.addJob("job " + std::to_string(i), []() {},
+                     std::chrono::milliseconds(1));
+    }
+    manager.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    auto before = manager.executorStats().completed;
+    auto begin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    auto runs = manager.executorStats().completed - before;
+    double secs = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - begin)
+                      .count();
+    manager.stop();
+    std::printf("  %2zu shards:                   %10.0f runs/s\n", shards,
+                runs / secs);
+  }
+}
+
+// Restart cost with a state file: opening it and re-adding every job, which
+// looks each one up in the mapped table, against adding without state.
+static void benchRestart(int jobs) {
+  std::string path = "/tmp/cron_benchmark_" + std::to_string(jobs) + ".state";
+  std::remove(path.c_str());
+  CronJobManager::Options options;
+  options.workers = 2;
+  options.state_file = path;
+  auto addAll = [jobs](CronJobManager &manager) {
+    JobOptions once;
+    once.catch_up = CatchUp::Once;
+    for (int i = 0; i < jobs; ++i) {
+      manager.addJob("job " + std::to_string(i), []() {},
+                     std::chrono::seconds(60 + i % 3600), once);
+    }
+  };
+  {
+    CronJobManager manager(options);
+    addAll(manager);
+  }
+
+  std::unique_ptr<CronJobManager> restored;
+  double open = timeNs([&]() {
+    restored = std::make_unique<CronJobManager>(options);
+  });
+  double restore = timeNs([&]() { addAll(*restored); });
+  restored.reset();
+
+  CronJobManager::Options plain;
+  plain.workers = 2;
+  std::unique_ptr<CronJobManager> fresh =
+      std::make_unique<CronJobManager>(plain);
+  double add = timeNs([&]() { addAll(*fresh); });
+  fresh.reset();
+  std::remove(path.c_str());
+
+  std::printf("  restart: open state file:    %10.1f us\n", open / 1e3);
+  std::printf("  restart: re-add with state:  %10.1f ns/job\n",
+              restore / jobs);
+  std::printf("  add without state:           %10.1f ns/job\n", add / jobs);
+}
+
+// Runs of 20 quick jobs over 1 s on 2 workers while two jobs hang for
+// 1.5 s ignoring their stop_token, without and with a 100 ms timeout; then
+// how long stop() takes with a 50 ms drain when a job only returns once it
+// is asked to.
+static void benchTimeouts() {
+  std::printf("stuck jobs (2 hang 1.5 s ignoring the token, 2 workers)\n");
+  for (int timeout : {0, 100}) {
+    CronJobManager manager(2);
+    std::atomic<int> quick{0};
+    JobOptions options;
+    options.timeout = std::chrono::milliseconds(timeout);
+    for (int i = 0; i < 2; ++i) {
+      manager.addJob(
+          "stuck " + std::to_string(i),
+          []() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+          },
+          std::chrono::milliseconds(10), options);
+    }
+    for (int i = 0; i < 20; ++i) {
+      manager.addJob("quick " + std::to_string(i), [&quick]() { ++quick; },
+                     std::chrono::milliseconds(10));
+    }
+    manager.start();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    int runs = quick.load();
+    std::size_t stand_ins = manager.executorStats().compensating;
+    manager.stop();
+    std::printf("  timeout %3d ms: quick runs in 1 s %6d, stand-in workers "
+                "%zu\n",
+                timeout, runs, stand_ins);
+  }
+
+  CronJobManager manager(2);
+  manager.addJob(
+      "poll",
+      [](std::stop_token stop) {
+        while (!stop.stop_requested()) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      },
+      std::chrono::milliseconds(10));
+  manager.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  auto begin = std::chrono::steady_clock::now();
+  bool drained = manager.stop(std::chrono::milliseconds(50));
+  std::printf("  stop() with a 50 ms drain, cooperative job: %8.2f ms "
+              "(drained %s)\n",
+              std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - begin)
+                  .count(),
+              drained ? "yes" : "no");
+}
+
+// Round trip of an empty task: handed to an in-process worker thread,
+// sent to a pre-forked worker process, and run in a process forked for it.
+// Then how long a run waits after the previous one crashed its worker.
+// Runs first, while the process has no other threads, as the pool needs.
+static void benchProcessPool() {
+  const int runs = 20000;
+  auto report = [](const char *label, std::vector<double> &us) {
+    std::sort(us.begin(), us.end());
+    std::printf("  %-24s p50 %8.1f us, p99 %8.1f us\n", label,
+                us[us.size() / 2], us[us.size() * 99 / 100]);
+  };
+
+  ProcessPool::Options options;
+  options.processes = 2;
+  ProcessPool pool({{"noop", []() {}}, {"crash", []() { ::_exit(1); }}},
+                   options);
+  std::size_t noop = pool.find("noop");
+  std::size_t crash = pool.find("crash");
+
+  std::printf("dispatch round trip of an empty task (%d runs)\n", runs);
+  std::vector<double> us;
+  {
+    Executor executor(1);
+    for (int i = 0; i < runs; ++i) {
+      std::atomic<bool> done{false};
+      us.push_back(timeNs([&]() {
+                     executor.submit([&done]() {
+                       done = true;
+                       done.notify_one();
+                     });
+                     done.wait(false);
+                   }) /
+                   1e3);
+    }
+  }
+  report("worker thread:", us);
+
+  us.clear();
+  for (int i = 0; i < runs; ++i) {
+    us.push_back(timeNs([&]() { pool.run(noop); }) / 1e3);
+  }
+  report("pre-forked process:", us);
+
+  us.clear();
+  for (int i = 0; i < 1000; ++i) {
+    us.push_back(timeNs([]() {
+                   pid_t pid = ::fork();
+                   if (pid == 0) {
+                     ::_exit(0);
+                   }
+                   ::waitpid(pid, nullptr, 0);
+                 }) /
+                 1e3);
+  }
+  report("fork per run:", us);
+
+  us.clear();
+  for (int i = 0; i < 200; ++i) {
+    pool.run(crash);
+    us.push_back(timeNs([&]() { pool.run(noop); }) / 1e3);
+  }
+  report("run after a crash:", us);
+  auto stats = pool.stats();
+  std::printf("  workers %zu, lost %llu, respawned %llu\n", stats.processes,
+              static_cast<unsigned long long>(stats.lost),
+              static_cast<unsigned long long>(stats.respawned));
+}
+
+// A day of schedules for 100k jobs replayed on a ManualClock: interval jobs
+// of 5 to 60 minutes at name-derived phases, every tenth one a cron job at
+// a quarter past the hour instead. One more job runs for 90 s of virtual
+// time every 60 s, so every run overruns the next.
+static void benchReplay() {
+  const int jobs = 100000;
+  ManualClock clock;
+  CronJobManager::Options options;
+  options.workers = 1;
+  options.clock = &clock;
+  // Measured separately by benchAccounting.
+  options.accounting = false;
+  CronJobManager manager(options);
+
+  std::atomic<std::uint64_t> runs{0};
+  const int minutes[] = {5, 15, 30, 60};
+  auto quarter = *CronSchedule::parse("15 * * * *");
+  JobOptions spread;
+  spread.spread = true;
+  for (int i = 0; i < jobs; ++i) {
+    auto task = [&runs]() { runs.fetch_add(1, std::memory_order_relaxed); };
+    std::string name = "job " + std::to_string(i);
+    if (i % 10 == 0) {
+      manager.addJob(name, task, quarter);
+    } else {
+      manager.addJob(name, task, std::chrono::minutes(minutes[i % 4]),
+                     spread);
+    }
+  }
+  manager.addJob(
+      "slow",
+      [&manager]() -> CronTask {
+        co_await manager.sleep(std::chrono::seconds(90));
+      },
+      60);
+
+  manager.start();
+  auto begin = std::chrono::steady_clock::now();
+  manager.advance(std::chrono::hours(24));
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+
+  std::chrono::microseconds max_lag{0};
+  for (const auto &job : manager.latencies()) {
+    if (job.name != "slow") {
+      max_lag = std::max(max_lag, job.schedule_lag.max());
+    }
+  }
+  std::uint64_t slow_runs = 0, slow_overruns = 0;
+  for (const auto &job : manager.status()) {
+    if (job.name == "slow") {
+      slow_runs = job.run_count;
+      slow_overruns = job.overruns;
+    }
+  }
+  manager.stop();
+
+  std::printf("virtual-time replay of 24 h (%d jobs)\n", jobs);
+  std::printf("  runs:                       %10llu\n",
+              static_cast<unsigned long long>(runs.load()));
+  std::printf("  real time:                  %10.2f s\n", seconds);
+  std::printf("  per run:                    %10.0f ns\n",
+              seconds * 1e9 / std::max<std::uint64_t>(runs.load(), 1));
+  std::printf("  max schedule lag:           %10lld us\n",
+              static_cast<long long>(max_lag.count()));
+  std::printf("  90 s job every 60 s:        %10llu runs, %llu overruns\n",
+              static_cast<unsigned long long>(slow_runs),
+              static_cast<unsigned long long>(slow_overruns));
+}
+
+// CPU time against run time for a job that spins and one that sleeps,
+// each 2 ms per run, then the cost of accounting per run: an hour of 10k
+// one-minute jobs replayed in virtual time with it off and on.
+static void benchAccounting() {
+  {
+    CronJobManager manager(2);
+    manager.addJob(
+        "spin",
+        []() {
+          auto until = std::chrono::steady_clock::now() +
+                       std::chrono::milliseconds(2);
+          while (std::chrono::steady_clock::now() < until) {
+          }
+        },
+        std::chrono::milliseconds(20));
+    manager.addJob(
+        "sleep",
+        []() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); },
+        std::chrono::milliseconds(20));
+    manager.start();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    manager.stop();
+    std::printf("per-job accounting (2 ms runs every 20 ms, 1 s)\n");
+    for (const auto &job : manager.status()) {
+      std::printf("  %-6s cpu %8.1f ms of %8.1f ms run time, %llu runs\n",
+                  job.name.c_str(),
+                  std::chrono::duration<double, std::milli>(job.cpu_time)
+                      .count(),
+                  std::chrono::duration<double, std::milli>(job.run_time)
+                      .count(),
+                  static_cast<unsigned long long>(job.run_count));
+    }
+  }
+
+  const int jobs = 10000;
+  for (bool accounting : {false, true}) {
+    ManualClock clock;
+    CronJobManager::Options options;
+    options.workers = 1;
+    options.clock = &clock;
+    options.accounting = accounting;
+    CronJobManager manager(options);
+    JobOptions spread;
+    spread.spread = true;
+    for (int i = 0; i < jobs; ++i) {
+      manager.addJob("job " + std::to_string(i), []() {},
+                     std::chrono::minutes(1), spread);
+    }
+    manager.start();
+    double ns = timeNs([&]() { manager.advance(std::chrono::hours(1)); });
+    std::printf("  accounting %-3s %8.0f ns per run\n",
+                accounting ? "on" : "off", ns / (jobs * 60.0));
+  }
+}
+
+int main() {
+  benchProcessPool();
+  for (int jobs : {10000, 100000, 1000000}) {
+    std::printf("%d registered jobs\n", jobs);
+    benchIdleCpu(jobs);
+    benchDispatch(jobs);
+    benchScan(jobs);
+    if (jobs <= 100000) {
+      benchRestart(jobs);
+    }
+  }
+  benchJitter();
+  benchFiring();
+  benchCronNext();
+  benchCoroutines();
+  benchPriorities();
+  benchSpread();
+  benchGraph();
+  benchShards();
+  benchTimeouts();
+  benchReplay();
+  benchAccounting();
+  return 0;
+}
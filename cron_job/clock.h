@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <ctime>
+
+// Time source of a CronJobManager. The scheduler keeps deadlines on a
+// monotonic timeline, as steady_clock time points, and evaluates cron
+// expressions and persisted state against the wall clock; a Clock supplies
+// both, and names the clock the scheduler threads sleep on.
+class Clock {
+public:
+  virtual ~Clock() = default;
+
+  virtual std::chrono::steady_clock::time_point now() const = 0;
+  virtual std::chrono::system_clock::time_point wall() const = 0;
+  // Clock for the scheduler's timerfd, in whose terms now() counts.
+  virtual clockid_t timerClock() const = 0;
+};
+
+// The default: deadlines follow CLOCK_MONOTONIC, so setting the system time
+// moves cron jobs but not interval jobs.
+class SteadyClock final : public Clock {
+public:
+  std::chrono::steady_clock::time_point now() const override {
+    return std::chrono::steady_clock::now();
+  }
+  std::chrono::system_clock::time_point wall() const override {
+    return std::chrono::system_clock::now();
+  }
+  clockid_t timerClock() const override { return CLOCK_MONOTONIC; }
+};
+
+// Deadlines follow the wall clock, CLOCK_REALTIME: when the system time is
+// set, interval jobs move with it, as they would under cron(8).
+class SystemClock final : public Clock {
+public:
+  std::chrono::steady_clock::time_point now() const override {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::system_clock::now().time_since_epoch()));
+  }
+  std::chrono::system_clock::time_point wall() const override {
+    return std::chrono::system_clock::now();
+  }
+  clockid_t timerClock() const override { return CLOCK_REALTIME; }
+};
+
+// Virtual time that stands still until CronJobManager::advanceTo() moves it,
+// for replaying schedules faster than real time and reproducing them
+// exactly. The wall clock starts at `start`, by default midnight UTC on
+// Monday 2024-01-01, and moves in step.
+class ManualClock final : public Clock {
+public:
+  explicit ManualClock(std::chrono::system_clock::time_point start =
+                           std::chrono::sys_days(std::chrono::year(2024) /
+                                                 1 / 1))
+      : start(start) {}
+
+  std::chrono::steady_clock::time_point now() const override {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(
+            ticks.load(std::memory_order_acquire)));
+  }
+  std::chrono::system_clock::time_point wall() const override {
+    return start + std::chrono::duration_cast<
+                       std::chrono::system_clock::duration>(
+                       now().time_since_epoch());
+  }
+  // Never waited on: the scheduler threads do not run in virtual time.
+  clockid_t timerClock() const override { return CLOCK_MONOTONIC; }
+
+  // Moves time forward to `t`; earlier times are ignored.
+  void set(std::chrono::steady_clock::time_point t) {
+    auto target = t.time_since_epoch().count();
+    auto seen = ticks.load(std::memory_order_relaxed);
+    while (seen < target &&
+           !ticks.compare_exchange_weak(seen, target,
+                                        std::memory_order_release)) {
+    }
+  }
+
+private:
+  std::chrono::system_clock::time_point start;
+  std::atomic<std::chrono::steady_clock::rep> ticks{0};
+};
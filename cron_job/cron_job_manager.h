@@ -0,0 +1,1427 @@
+#pragma once
+#include "clock.h"
+#include "cron_schedule.h"
+#include "cron_task.h"
+#include "event_loop.h"
+#include "executor.h"
+#include "job_graph.h"
+#include "job_status.h"
+#include "job_table.h"
+#include "resource_usage.h"
+#include "schedule_state.h"
+#include "timer_wheel.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class CronJob;
+
+// A wheel entry dispatches a job, ends a run that outlived its timeout
+// (`watchdog`), or resumes a sleeping coroutine.
+struct CronTimer {
+  CronJob *job = nullptr;
+  std::coroutine_handle<> waiter;
+  bool watchdog = false;
+};
+using CronWheel = TimerWheel<CronTimer>;
+
+// Per-job settings beyond the schedule, passed last to addJob:
+//
+//   manager.addJob("vacuum", vacuum, 300,
+//                  {.priority = Priority::Low, .group = "db"});
+struct JobOptions {
+  // Runs missed while the process was down; needs a state file.
+  CatchUp catch_up = CatchUp::Skip;
+  Priority priority = Priority::Normal;
+  // Concurrency group; runs of jobs in the same group are limited by
+  // CronJobManager::setConcurrencyLimit. Empty for none.
+  std::string group;
+  // Interval jobs only: fire at a fixed phase within the interval, derived
+  // from the job's name, instead of counting from when the job was added.
+  // Jobs sharing an interval then spread evenly over it, and since the
+  // phase is taken against the wall clock it is the same after a restart.
+  bool spread = false;
+  // Delays each run by a fresh random amount in [0, splay), without
+  // shifting the schedule itself.
+  std::chrono::milliseconds splay{0};
+  // Longest a run may take before its stop_token is signalled; zero for no
+  // limit. A plain run that ignores the token keeps its thread, but the
+  // executor gets a stand-in worker until it returns.
+  std::chrono::milliseconds timeout{0};
+};
+
+// A due run on its way to a worker.
+struct QueuedRun {
+  CronJob *job;
+  std::chrono::steady_clock::time_point due;
+  std::chrono::steady_clock::time_point queued;
+};
+
+// Jobs of one concurrency group and the runs waiting for a free slot.
+struct ConcurrencyGroup {
+  std::size_t limit = SIZE_MAX;
+  std::size_t running = 0;
+  std::array<std::deque<QueuedRun>, PRIORITIES> waiting;
+};
+
+class CronJob {
+public:
+  CronJob(std::string name, JobTask task, std::chrono::milliseconds interval,
+          const Clock &clock)
+      : name(std::move(name)), task(std::move(task.plain)),
+        coroutine(std::move(task.coroutine)), interval(interval),
+        last_run(clock.now()), next_due(last_run + interval) {}
+
+  // Fires at the times matched by `schedule` instead of a fixed interval.
+  CronJob(std::string name, JobTask task, CronSchedule schedule,
+          const Clock &clock)
+      : name(std::move(name)), task(std::move(task.plain)),
+        coroutine(std::move(task.coroutine)), interval(0), cron(schedule),
+        last_run(clock.now()), cron_due(cron->next(clock.wall())),
+        next_due(toSteady(cron_due, clock)) {}
+
+  // Jobs stay at a fixed address in the job table for their whole lifetime,
+  // so they are neither copyable nor movable.
+  CronJob(const CronJob &) = delete;
+  CronJob &operator=(const CronJob &) = delete;
+
+  std::string name;
+  // Exactly one of `task` and `coroutine` is set.
+  InlineFunction<void(std::stop_token)> task;
+  InlineFunction<CronTask(std::stop_token)> coroutine;
+  std::chrono::milliseconds interval;
+  std::optional<CronSchedule> cron;
+  // Lives in the job table next to the job's slot. Written by whichever
+  // thread owns the run; read lock-free by status() and summary().
+  JobState *state = nullptr;
+  // Null when the manager does not record latencies.
+  std::unique_ptr<JobHistograms> histograms;
+  std::chrono::steady_clock::time_point last_run;
+  // Wall-clock time of the cron fire time that next_due stands for.
+  std::chrono::system_clock::time_point cron_due;
+  // time_point::max() when the job will never fire again.
+  std::chrono::steady_clock::time_point next_due;
+
+  // Scheduler bookkeeping, guarded by the mutex of the job's shard.
+  std::size_t slot = 0;
+  std::size_t shard = 0;
+  // Persisted schedule, if the manager keeps a state file and it had room.
+  ScheduleRecord *record = nullptr;
+  CatchUp catch_up = CatchUp::Skip;
+  Priority priority = Priority::Normal;
+  ConcurrencyGroup *group = nullptr;
+  bool spread = false;
+  std::chrono::milliseconds splay{0};
+  // When the armed timer fires: next_due plus this run's splay.
+  std::chrono::steady_clock::time_point fire_at;
+  std::chrono::milliseconds timeout{0};
+  // Source of the current run's stop_token. Replaced at dispatch once it
+  // has been used, so a cancelled run does not cancel the next one.
+  std::stop_source cancel;
+  CronWheel::TimerId watchdog = CronWheel::npos;
+  // The run outlived its timeout and the executor has a stand-in for it.
+  bool timed_out = false;
+  // Usage of the run in flight, summed over the stretches of it that have
+  // finished on some thread; a coroutine run has one per resumption.
+  std::chrono::nanoseconds run_cpu{0};
+  std::uint64_t run_bytes = 0;
+  // Replaying runs missed while the process was down (CatchUp::All).
+  bool catching_up = false;
+  CronWheel::TimerId timer = CronWheel::npos;
+  bool in_flight = false;
+  bool paused = false;
+  bool removed = false;
+
+  static std::chrono::steady_clock::time_point
+  toSteady(std::chrono::system_clock::time_point wall, const Clock &clock) {
+    if (wall == std::chrono::system_clock::time_point::max()) {
+      return std::chrono::steady_clock::time_point::max();
+    }
+    auto offset = wall - clock.wall();
+    return clock.now() +
+           std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+               offset);
+  }
+};
+
+class CronJobManager {
+public:
+  struct Options {
+    std::size_t workers = std::max(2u, std::thread::hardware_concurrency());
+    // Jobs are spread over this many scheduler threads by a hash of their
+    // name. Each shard has its own timer wheel, lock and wakeup, so dispatch
+    // scales past one core on hosts with many jobs.
+    std::size_t shards = 1;
+    // Pins shard i to CPU i modulo the number of CPUs (Linux only).
+    bool pin_shards = false;
+    // Memory-mapped file keeping each job's last run and next due time
+    // across restarts; empty for none. Created if missing.
+    std::string state_file;
+    // Jobs the state file can hold; fixed when the file is created.
+    std::size_t state_capacity = 1 << 17;
+    // Time source, SteadyClock when null. With a ManualClock no scheduler
+    // thread runs and time only moves through advanceTo(). Must outlive the
+    // manager.
+    Clock *clock = nullptr;
+    // Per-run thread CPU time and allocated bytes, in status(). Costs two
+    // clock_gettime calls per run, under a microsecond.
+    bool accounting = true;
+    // Per-job latency histograms, for latencies(). Each job's are allocated
+    // when it is added, about 3 KB per job, so recording a run never
+    // allocates.
+    bool latencies = true;
+  };
+
+  // Jobs run on a fixed pool of `workers` threads fed by the scheduler.
+  explicit CronJobManager(
+      std::size_t workers = std::max(2u, std::thread::hardware_concurrency()))
+      : CronJobManager(withWorkers(workers)) {}
+
+  // Throws std::system_error if the state file cannot be opened.
+  explicit CronJobManager(const Options &options)
+      : clock(options.clock ? options.clock : &defaultClock()),
+        manual(dynamic_cast<ManualClock *>(clock)), epoch(clock->now()),
+        pin_shards(options.pin_shards), accounting(options.accounting),
+        record_latencies(options.latencies), executor(options.workers) {
+    if (!options.state_file.empty()) {
+      state = std::make_unique<ScheduleState>(options.state_file,
+                                              options.state_capacity);
+    }
+    for (std::size_t i = 0; i < std::max<std::size_t>(options.shards, 1);
+         ++i) {
+      shards.emplace_back(std::make_unique<Shard>(clock->timerClock()));
+    }
+  }
+
+  CronJobManager(const CronJobManager &) = delete;
+  CronJobManager &operator=(const CronJobManager &) = delete;
+
+  ~CronJobManager() { stop(); }
+
+  // Jobs can be added, removed, paused and resumed at any time, including
+  // while the scheduler is running. Names are unique: addJob returns false
+  // if the name is already taken, the others return false if it is unknown.
+
+  // `task` is any callable; one returning CronTask runs as a coroutine that
+  // can co_await sleep() without holding a worker thread. Either kind may
+  // take a std::stop_token, signalled when the run times out (see
+  // JobOptions::timeout), its job is removed or the manager is stopping.
+  // A plain run that throws is counted in JobStatus::failures and the job
+  // stays scheduled.
+
+  // With a state file, a job added under a name it has persisted state for
+  // picks its schedule up where the previous process left it, and
+  // `options.catch_up` decides what happens to runs missed in between.
+
+  // Intervals are rounded up to whole milliseconds.
+  template <typename Rep, typename Period>
+  bool addJob(std::string name, JobTask task,
+              std::chrono::duration<Rep, Period> interval,
+              const JobOptions &options = {}) {
+    auto ms = std::chrono::ceil<std::chrono::milliseconds>(interval);
+    auto job = std::make_unique<CronJob>(std::move(name), std::move(task),
+                                         std::max(ms, min_interval), *clock);
+    return add(std::move(job), options);
+  }
+
+  // Runs `task` at the times matched by a cron expression, evaluated in UTC:
+  //
+  //   manager.addJob("report", report, *CronSchedule::parse("0 9 * * MON"));
+  bool addJob(std::string name, JobTask task, const CronSchedule &schedule,
+              const JobOptions &options = {}) {
+    return add(
+        std::make_unique<CronJob>(std::move(name), std::move(task), schedule,
+                                  *clock),
+        options);
+  }
+
+  bool addJob(std::string name, JobTask task, int interval_seconds,
+              const JobOptions &options = {}) {
+    return addJob(std::move(name), std::move(task),
+                  std::chrono::seconds(interval_seconds), options);
+  }
+
+  // At most `limit` runs of the jobs in `group` execute at once; due runs
+  // beyond that wait, highest priority first, for one to finish. Groups are
+  // unlimited until a limit is set, and the limit can change at any time.
+  void setConcurrencyLimit(const std::string &group, std::size_t limit) {
+    std::size_t admitted;
+    {
+      std::lock_guard<std::mutex> lock(run_mutex);
+      ConcurrencyGroup &g = groupOf(group);
+      g.limit = std::max<std::size_t>(limit, 1);
+      admitted = admitWaiting(g);
+    }
+    for (std::size_t i = 0; i < admitted; ++i) {
+      post();
+    }
+  }
+
+  // A run that is in flight is asked to stop through its stop_token; the job
+  // is freed once that run returns.
+  bool removeJob(const std::string &name) {
+    std::lock_guard<std::mutex> registry(registry_mutex);
+    auto it = by_name.find(name);
+    if (it == by_name.end()) {
+      return false;
+    }
+    CronJob *job = it->second;
+    by_name.erase(it);
+    jobs.remove(job->slot);
+    std::lock_guard<std::mutex> lock(shardOf(job).mutex);
+    job->removed = true;
+    disarm(job);
+    if (job->in_flight) {
+      job->cancel.request_stop();
+    } else {
+      retire(job);
+    }
+    return true;
+  }
+
+  // A paused job keeps its state and statistics but is not dispatched; a
+  // run already in flight still completes.
+  bool pauseJob(const std::string &name) {
+    std::lock_guard<std::mutex> registry(registry_mutex);
+    auto it = by_name.find(name);
+    if (it == by_name.end()) {
+      return false;
+    }
+    CronJob *job = it->second;
+    std::lock_guard<std::mutex> lock(shardOf(job).mutex);
+    if (!job->paused) {
+      job->paused = true;
+      job->state->setPaused(true);
+      disarm(job);
+    }
+    return true;
+  }
+
+  // Restarts the schedule from now: the next run is one interval away (the
+  // next phase for spread jobs), or the next matching time for cron jobs.
+  bool resumeJob(const std::string &name) {
+    std::lock_guard<std::mutex> registry(registry_mutex);
+    auto it = by_name.find(name);
+    if (it == by_name.end()) {
+      return false;
+    }
+    CronJob *job = it->second;
+    Shard &shard = shardOf(job);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (job->paused) {
+      job->paused = false;
+      job->state->setPaused(false);
+      if (!job->in_flight) {
+        restartDeadline(job);
+        persist(job);
+        arm(shard, job);
+        kick(shard);
+      }
+    }
+    return true;
+  }
+
+  // Can be called again after stop(), which disarms every job: the worker
+  // pool is restarted and the jobs are armed again, each firing at once if
+  // it fell due while the manager was stopped.
+  void start() {
+    executor.restart();
+    jobs.forEach([this](CronJob &job) {
+      Shard &shard = shardOf(&job);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      if (job.timer == CronWheel::npos && !job.paused && !job.in_flight) {
+        arm(shard, &job);
+      }
+    });
+    running = true;
+    draining = false;
+    if (manual) {
+      return;
+    }
+    for (std::size_t i = 0; i < shards.size(); ++i) {
+      Shard &shard = *shards[i];
+      shard.thread = std::thread(&CronJobManager::run, this, std::ref(shard));
+      if (pin_shards) {
+        pin(shard.thread, i);
+      }
+    }
+  }
+
+  // Stops dispatching and waits for runs that are queued or executing. Runs
+  // still going once `drain` has passed are asked to stop through their
+  // stop_token and waited for until they return. Coroutine runs sleeping in
+  // sleep() are abandoned: their frames are destroyed at the co_await and
+  // the runs count as finished.
+  // Returns false if the drain period ran out.
+  bool stop(
+      std::chrono::milliseconds drain = std::chrono::milliseconds::max()) {
+    bool drained = true;
+    if (running && !draining.exchange(true)) {
+      auto deadline = drain == std::chrono::milliseconds::max()
+                          ? time_point::max()
+                          : std::chrono::steady_clock::now() + drain;
+      drained = awaitRuns(deadline);
+      if (!drained) {
+        cancelAll();
+        awaitRuns(time_point::max());
+      }
+    }
+
+    for (auto &shard : shards) {
+      {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        running = false;
+      }
+      shard->loop.wake();
+    }
+    for (auto &shard : shards) {
+      if (shard->thread.joinable()) {
+        shard->thread.join();
+      }
+    }
+    executor.shutdown();
+    if (state) {
+      state->flush();
+    }
+
+    std::vector<CronTimer> parked;
+    for (auto &shard : shards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      shard->schedule.clear([&parked](CronTimer &timer) {
+        if (timer.waiter) {
+          parked.push_back(timer);
+        } else if (timer.watchdog) {
+          timer.job->watchdog = CronWheel::npos;
+        } else {
+          timer.job->timer = CronWheel::npos;
+        }
+      });
+    }
+    for (const CronTimer &timer : parked) {
+      timer.waiter.destroy();
+      sleepers.fetch_sub(1, std::memory_order_relaxed);
+      abandon(timer.job);
+    }
+    return drained;
+  }
+
+  // Awaitable for coroutine jobs: suspends the calling coroutine on the
+  // scheduler's timer wheel and resumes it on the executor once `delay` has
+  // passed. Returns immediately once the manager is stopping.
+  template <typename Rep, typename Period>
+  auto sleep(std::chrono::duration<Rep, Period> delay) {
+    return sleepUntil(clock->now() +
+                      std::chrono::ceil<std::chrono::steady_clock::duration>(
+                          delay));
+  }
+
+  auto sleepUntil(std::chrono::steady_clock::time_point deadline) {
+    struct Awaiter {
+      CronJobManager *manager;
+      std::chrono::steady_clock::time_point deadline;
+
+      bool await_ready() const { return deadline <= manager->clock->now(); }
+      bool await_suspend(std::coroutine_handle<> waiter) {
+        return manager->park(deadline, waiter);
+      }
+      void await_resume() const {}
+    };
+    return Awaiter{this, deadline};
+  }
+
+  // Virtual time only (Options::clock is a ManualClock): moves the clock to
+  // `until`, stopping at every tick on the way at which something is due.
+  // What is due runs to completion, or to its next co_await, on the calling
+  // thread before time moves on, so a replay takes no real time beyond the
+  // runs themselves and repeats exactly. Runs take no virtual time unless
+  // they co_await sleep(). Needs start(); must not be called from a job.
+  void advanceTo(std::chrono::steady_clock::time_point until) {
+    if (!manual || !running) {
+      return;
+    }
+    std::uint64_t last =
+        until <= epoch ? 0 : std::chrono::floor<Tick>(until - epoch).count();
+    while (true) {
+      std::uint64_t next = CronWheel::never;
+      for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        next = std::min(next, shard->schedule.nextTick());
+      }
+      if (next == CronWheel::never || next > last) {
+        break;
+      }
+      manual->set(fromTick(next));
+      for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->schedule.advance(next,
+                                [this](CronTimer &timer) { fire(timer); });
+      }
+      runDeferred();
+    }
+    manual->set(until);
+  }
+
+  template <typename Rep, typename Period>
+  void advance(std::chrono::duration<Rep, Period> by) {
+    advanceTo(clock->now() +
+              std::chrono::ceil<std::chrono::steady_clock::duration>(by));
+  }
+
+  Executor::Stats executorStats() const { return executor.stats(); }
+
+  std::size_t shardCount() const { return shards.size(); }
+
+  // Times the scheduler threads woke up: once per tick that had something
+  // due or a wheel slot to cascade, plus one per stop() or watched-fd event.
+  // While idle only cascades remain, at most one per level boundary.
+  std::uint64_t schedulerWakeups() const {
+    std::uint64_t total = 0;
+    for (const auto &shard : shards) {
+      total += shard->wakeups.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  // Runs `handler` on the executor each time `fd` is ready for `events`
+  // (EPOLLIN, EPOLLOUT, ...), for example to trigger work from a socket or
+  // an eventfd. The scheduler's epoll loop watches the fd; the handler must
+  // consume the event, and it is not called again until it has returned.
+  // Returns false if `fd` is already watched or cannot be.
+  bool watch(int fd, std::uint32_t events, std::function<void()> handler) {
+    std::lock_guard<std::mutex> lock(watch_mutex);
+    if (watches.count(fd)) {
+      return false;
+    }
+    auto entry = std::make_shared<Watch>(Watch{fd, events, std::move(handler)});
+    if (!shards[0]->loop.add(fd, events | EPOLLONESHOT)) {
+      return false;
+    }
+    watches.emplace(fd, std::move(entry));
+    return true;
+  }
+
+  // A handler already running finishes, but is not called again.
+  bool unwatch(int fd) {
+    std::lock_guard<std::mutex> lock(watch_mutex);
+    auto it = watches.find(fd);
+    if (it == watches.end()) {
+      return false;
+    }
+    it->second->active = false;
+    shards[0]->loop.remove(fd);
+    watches.erase(it);
+    return true;
+  }
+
+  // Queueing delay per priority class: from a run coming due to a worker
+  // starting it, including any wait for a slot in its concurrency group.
+  std::vector<ClassLatency> classLatencies() const {
+    std::vector<ClassLatency> result;
+    for (std::size_t p = 0; p < PRIORITIES; ++p) {
+      result.push_back({static_cast<Priority>(p), class_delay[p].snapshot()});
+    }
+    return result;
+  }
+
+  // Consistent per-job snapshots, taken without blocking the scheduler or
+  // the workers.
+  std::vector<JobStatus> status() const {
+    std::vector<JobStatus> result;
+    result.reserve(jobs.size());
+    jobs.forEach([&result](const CronJob &job) {
+      JobStatus &entry = result.emplace_back();
+      entry.name = job.name;
+      job.state->read(entry);
+    });
+    return result;
+  }
+
+  // Job count, running and paused counts and the earliest due time of the
+  // idle jobs, from one pass over the job table's contiguous state arrays.
+  JobSummary summary() const {
+    JobSummary result;
+    jobs.forEachHot([&result](const JobState &state) {
+      ++result.jobs;
+      result.running += state.running();
+      result.paused += state.paused();
+      if (!state.running() && !state.paused()) {
+        result.next_due = std::min(result.next_due, state.nextDue());
+      }
+    });
+    return result;
+  }
+
+  // Schedule lag, queue wait and run duration distributions per job, read
+  // without blocking the scheduler. Jobs that have not run yet are skipped.
+  std::vector<JobLatency> latencies() const {
+    std::vector<JobLatency> result;
+    jobs.forEach([&result](const CronJob &job) {
+      const JobHistograms *h = job.histograms.get();
+      if (h == nullptr) {
+        return;
+      }
+      auto duration = h->duration.snapshot();
+      if (duration.count() > 0) {
+        result.push_back({job.name, job.interval, h->schedule_lag.snapshot(),
+                          h->queue_wait.snapshot(), duration});
+      }
+    });
+    return result;
+  }
+
+  // One line per job with p50/p99/max of each distribution, in ms.
+  void printLatencies() const {
+    auto snapshot = latencies();
+    auto ms = [](std::chrono::microseconds us) { return us.count() / 1e3; };
+    auto triple = [&ms](const LatencyHistogram::Snapshot &h) {
+      std::ostringstream out;
+      out << ms(h.quantile(0.5)) << "/" << ms(h.quantile(0.99)) << "/"
+          << ms(h.max());
+      return out.str();
+    };
+
+    std::cout << "Latency p50/p99/max (ms):\n";
+    for (const auto &job : snapshot) {
+      std::cout << job.name << ": lag " << triple(job.schedule_lag)
+                << ", wait " << triple(job.queue_wait) << ", run "
+                << triple(job.duration);
+      if (job.interval.count() > 0) {
+        std::cout << " every " << job.interval.count() << " ms";
+      }
+      std::cout << ", " << job.duration.count() << " runs\n";
+    }
+    static const char *const names[] = {"high", "normal", "low"};
+    std::cout << "Queueing delay by priority:";
+    for (const auto &c : classLatencies()) {
+      std::cout << " " << names[static_cast<int>(c.priority)] << " "
+                << triple(c.queue_delay);
+    }
+    std::cout << "\n" << std::endl;
+  }
+
+  void printStatus() const {
+    auto snapshot = status();
+    auto stats = executor.stats();
+
+    auto now = clock->wall();
+    auto now_c = std::chrono::system_clock::to_time_t(now);
+    std::stringstream ss;
+    ss << std::put_time(std::localtime(&now_c), "%Y-%m-%d %H:%M:%S");
+
+    std::cout << "Current status at " << ss.str() << ":\n";
+    for (const auto &job : snapshot) {
+      std::cout << job.name << ": "
+                << (job.running ? "Running" : "Not running") << ", runs "
+                << job.run_count << ", overruns " << job.overruns
+                << ", timeouts " << job.timeouts << ", failures "
+                << job.failures << ", last took "
+                << std::chrono::duration<double, std::milli>(
+                       job.last_duration)
+                       .count()
+                << " ms, cpu "
+                << std::chrono::duration<double, std::milli>(job.cpu_time)
+                       .count()
+                << " of "
+                << std::chrono::duration<double, std::milli>(job.run_time)
+                       .count()
+                << " ms";
+      if (job.allocated > 0) {
+        std::cout << ", allocated " << job.allocated / 1024 << " KiB";
+      }
+      std::cout << "\n";
+    }
+
+    auto avg_wait = stats.started == 0
+                        ? 0.0
+                        : std::chrono::duration<double, std::milli>(
+                              stats.total_queue_wait)
+                                  .count() /
+                              stats.started;
+    std::cout << "Shards: " << shards.size() << ", workers "
+              << executor.size() << " (+" << stats.compensating
+              << " standing in), queued "
+              << stats.queued << ", stolen " << stats.stolen
+              << ", avg queue wait " << avg_wait
+              << " ms, max "
+              << std::chrono::duration<double, std::milli>(
+                     stats.max_queue_wait)
+                     .count()
+              << " ms\n";
+    std::cout << std::endl;
+  }
+
+private:
+  using time_point = std::chrono::steady_clock::time_point;
+  static constexpr std::chrono::milliseconds min_interval{1};
+  // Wheel resolution. The timerfd wakes the scheduler at the exact tick, so
+  // a run starts at most one tick after its due time.
+  using Tick = std::chrono::duration<std::int64_t, std::ratio<1, 10000>>;
+
+  // One scheduler thread with the wheel of the jobs hashed to it. A job's
+  // bookkeeping fields are guarded by its shard's mutex.
+  struct Shard {
+    explicit Shard(clockid_t clock) : loop(clock) {}
+
+    std::mutex mutex;
+    CronWheel schedule;
+    // Sleeps until `armed`, the tick the loop's timer is set for.
+    EventLoop loop;
+    std::uint64_t armed = CronWheel::never;
+    std::atomic<std::uint64_t> wakeups{0};
+    std::thread thread;
+  };
+
+  struct Watch {
+    int fd;
+    std::uint32_t events;
+    std::function<void()> handler;
+    bool active = true;
+  };
+
+  Shard &shardOf(const CronJob *job) { return *shards[job->shard]; }
+
+  static Options withWorkers(std::size_t workers) {
+    Options options;
+    options.workers = workers;
+    return options;
+  }
+
+  static void pin(std::thread &thread, std::size_t index) {
+#ifdef __linux__
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cpus, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)index;
+#endif
+  }
+
+  // Wheel ticks are counted from when the manager was created; a deadline
+  // maps to the first tick at or after it so jobs never fire early.
+  std::uint64_t toTick(time_point t) const {
+    if (t <= epoch) {
+      return 0;
+    }
+    return std::chrono::ceil<Tick>(t - epoch).count();
+  }
+
+  time_point fromTick(std::uint64_t t) const { return epoch + Tick(t); }
+
+  // Sleeps until the wheel's next deadline and dispatches only the jobs that
+  // are due. A job is off the wheel while it runs and is re-armed with its
+  // next deadline when it finishes, so it can never overlap with itself.
+  void run(Shard &shard) {
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    while (running) {
+      shard.wakeups.fetch_add(1, std::memory_order_relaxed);
+      auto now = clock->now();
+      shard.schedule.advance(std::chrono::floor<Tick>(now - epoch).count(),
+                             [this](CronTimer &timer) { fire(timer); });
+
+      kick(shard);
+      lock.unlock();
+      bool fired = shard.loop.wait(
+          [this](int fd, std::uint32_t) { watchReady(fd); });
+      lock.lock();
+      if (fired) {
+        shard.armed = CronWheel::never;
+      }
+    }
+  }
+
+  // A wheel entry is due. Called with its shard's mutex held.
+  void fire(CronTimer &timer) {
+    if (timer.waiter) {
+      sleepers.fetch_sub(1, std::memory_order_relaxed);
+      post(timer.waiter, timer.job);
+    } else if (timer.watchdog) {
+      expire(timer.job);
+    } else if (draining) {
+      timer.job->timer = CronWheel::npos;
+    } else {
+      dispatch(timer.job);
+    }
+  }
+
+  // Hands the executor a coroutine to resume, parked by a run of `job` if
+  // not null, or with a null handle a slot in the run queue (see dispatch).
+  // In virtual time both wait for the thread in advanceTo() instead, which
+  // runs them after it lets go of the shard's lock.
+  void post(std::coroutine_handle<> waiter = {}, CronJob *job = nullptr) {
+    if (manual) {
+      std::lock_guard<std::mutex> lock(deferred_mutex);
+      deferred.push_back({job, waiter});
+    } else if (waiter) {
+      executor.submit([this, job, waiter]() { resume(job, waiter); });
+    } else {
+      executor.submit([this]() { runNext(); });
+    }
+  }
+
+  void resume(CronJob *job, std::coroutine_handle<> waiter) {
+    Meter outer = beginSegment(job);
+    waiter.resume();
+    endSegment(outer);
+  }
+
+  // Runs what post() deferred, including what those runs post in turn.
+  void runDeferred() {
+    std::vector<CronTimer> batch;
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(deferred_mutex);
+        if (deferred.empty()) {
+          return;
+        }
+        batch.swap(deferred);
+      }
+      for (const CronTimer &entry : batch) {
+        if (entry.waiter) {
+          resume(entry.job, entry.waiter);
+        } else {
+          runNext();
+        }
+      }
+      batch.clear();
+    }
+  }
+
+  static Clock &defaultClock() {
+    static SteadyClock clock;
+    return clock;
+  }
+
+  // Moves the shard's timer forward if the wheel now has an earlier
+  // deadline. Threads adding timers re-arm it directly instead of waking
+  // the scheduler, so it only runs when something is due. Called with the
+  // shard's mutex held.
+  void kick(Shard &shard) {
+    if (manual) {
+      return;
+    }
+    auto next = shard.schedule.nextTick();
+    if (next < shard.armed) {
+      shard.armed = next;
+      shard.loop.armAt(fromTick(next));
+    }
+  }
+
+  // A watched descriptor is ready: run its handler on the executor, then
+  // watch it again. Watches are one-shot in between, so a handler never
+  // overlaps with itself and a level-triggered fd does not spin.
+  void watchReady(int fd) {
+    std::shared_ptr<Watch> watch;
+    {
+      std::lock_guard<std::mutex> lock(watch_mutex);
+      auto it = watches.find(fd);
+      if (it == watches.end()) {
+        return;
+      }
+      watch = it->second;
+    }
+    executor.submit([this, watch]() {
+      watch->handler();
+      std::lock_guard<std::mutex> lock(watch_mutex);
+      if (watch->active) {
+        shards[0]->loop.modify(watch->fd, watch->events | EPOLLONESHOT);
+      }
+    });
+  }
+
+  bool add(std::unique_ptr<CronJob> job, const JobOptions &options) {
+    std::lock_guard<std::mutex> registry(registry_mutex);
+    CronJob *raw = job.get();
+    if (!by_name.emplace(raw->name, raw).second) {
+      return false;
+    }
+    raw->catch_up = options.catch_up;
+    raw->priority = options.priority;
+    raw->spread = options.spread && !raw->cron;
+    raw->splay = options.splay;
+    raw->timeout = options.timeout;
+    if (record_latencies) {
+      raw->histograms = std::make_unique<JobHistograms>();
+    }
+    if (raw->spread) {
+      raw->next_due = nextPhase(raw, clock->now());
+    }
+    if (!options.group.empty()) {
+      std::lock_guard<std::mutex> lock(run_mutex);
+      raw->group = &groupOf(options.group);
+    }
+    raw->shard = std::hash<std::string>{}(raw->name) % shards.size();
+    raw->slot = jobs.add(std::move(job), [](CronJob &added, JobState &hot) {
+      hot.reset();
+      added.state = &hot;
+    });
+    if (state) {
+      bool found = false;
+      raw->record = state->claim(raw->name, found);
+      if (found) {
+        restore(raw);
+      }
+      persist(raw);
+    }
+    Shard &shard = shardOf(raw);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    arm(shard, raw);
+    kick(shard);
+    return true;
+  }
+
+  void arm(Shard &shard, CronJob *job) {
+    if (job->next_due != time_point::max()) {
+      job->fire_at = job->next_due + splayDelay(job);
+      job->state->setNextDue(job->next_due);
+      job->timer = shard.schedule.insert(toTick(job->fire_at), {job, {}});
+    }
+  }
+
+  static std::chrono::nanoseconds splayDelay(const CronJob *job) {
+    if (job->splay.count() <= 0) {
+      return std::chrono::nanoseconds(0);
+    }
+    static thread_local std::mt19937_64 random(std::random_device{}());
+    std::uniform_int_distribution<std::int64_t> delay(
+        0, std::chrono::nanoseconds(job->splay).count() - 1);
+    return std::chrono::nanoseconds(delay(random));
+  }
+
+  // First time at or after `after` that sits at the job's phase within its
+  // interval, counted on the wall clock from the epoch. The phase is the
+  // name's stable hash modulo the interval, in whole milliseconds.
+  time_point nextPhase(const CronJob *job, time_point after) {
+    std::int64_t period = std::chrono::nanoseconds(job->interval).count();
+    auto slots = static_cast<std::uint64_t>(job->interval.count());
+    auto phase = static_cast<std::int64_t>(stableHash(job->name) % slots) *
+                 std::int64_t{1000000};
+    std::int64_t wall = toNanos(clock->wall()) +
+                        std::chrono::nanoseconds(
+                            after - clock->now())
+                            .count();
+    std::int64_t offset = ((wall - phase) % period + period) % period;
+    return after + std::chrono::nanoseconds(offset == 0 ? 0 : period - offset);
+  }
+
+  void disarm(CronJob *job) {
+    if (job->timer != CronWheel::npos) {
+      shardOf(job).schedule.cancel(job->timer);
+      job->timer = CronWheel::npos;
+    }
+  }
+
+  // Arms a timer that resumes `waiter`; false (resume now) when stopping.
+  // Once the timer is armed another worker may resume the coroutine, so
+  // nothing in its frame is touched afterwards. Sleepers are spread over the
+  // shards by frame address.
+  bool park(time_point deadline, std::coroutine_handle<> waiter) {
+    Shard &shard =
+        *shards[std::hash<void *>{}(waiter.address()) % shards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!running) {
+      return false;
+    }
+    // Settled before the timer is visible to whoever resumes the coroutine.
+    CronJob *job = meter().job;
+    closeSegment(job);
+    shard.schedule.insert(toTick(deadline), {job, waiter});
+    kick(shard);
+    sleepers.fetch_add(1, std::memory_order_relaxed);
+    if (draining) {
+      notifyDrain();
+    }
+    return true;
+  }
+
+  void restartDeadline(CronJob *job) {
+    if (job->cron) {
+      job->cron_due = job->cron->next(clock->wall());
+      job->next_due = CronJob::toSteady(job->cron_due, *clock);
+    } else if (job->spread) {
+      job->next_due = nextPhase(job, clock->now());
+    } else {
+      job->next_due = clock->now() + job->interval;
+    }
+  }
+
+  // Due runs go through a run queue with one FIFO per priority class. The
+  // executor gets one anonymous task per queued run, and each task starts
+  // whichever run is best at the time it gets a worker, so under contention
+  // High runs overtake the Normal and Low ones queued before them. A run
+  // whose concurrency group is full waits in the group instead, and enters
+  // the run queue when a run of that group finishes.
+  void dispatch(CronJob *job) {
+    job->timer = CronWheel::npos;
+    job->in_flight = true;
+    if (job->cancel.stop_requested()) {
+      job->cancel = std::stop_source();
+    }
+    runs.fetch_add(1, std::memory_order_relaxed);
+    job->state->markDispatched();
+    QueuedRun run{job, job->fire_at, clock->now()};
+    {
+      std::lock_guard<std::mutex> lock(run_mutex);
+      ConcurrencyGroup *group = job->group;
+      if (group != nullptr && group->running >= group->limit) {
+        group->waiting[static_cast<std::size_t>(job->priority)].push_back(
+            run);
+        return;
+      }
+      if (group != nullptr) {
+        ++group->running;
+      }
+      ready[static_cast<std::size_t>(job->priority)].push_back(run);
+    }
+    post();
+  }
+
+  void runNext() {
+    QueuedRun run{};
+    {
+      std::lock_guard<std::mutex> lock(run_mutex);
+      for (std::size_t p = 0; p < PRIORITIES; ++p) {
+        if (!ready[p].empty()) {
+          run = ready[p].front();
+          ready[p].pop_front();
+          class_delay[p].record(clock->now() - run.queued);
+          break;
+        }
+      }
+    }
+    execute(run.job, run.due, run.queued);
+  }
+
+  void execute(CronJob *job, time_point due, time_point queued) {
+    job->last_run = clock->now();
+    auto started = clock->wall();
+    job->state->markStarted(started);
+    if (job->record) {
+      job->record->last_run.store(toNanos(started), std::memory_order_relaxed);
+    }
+    if (job->timeout.count() > 0) {
+      Shard &shard = shardOf(job);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      job->watchdog = shard.schedule.insert(
+          toTick(job->last_run + job->timeout), {job, {}, true});
+      kick(shard);
+    }
+    // Only dispatch replaces `cancel`, and never while a run is in flight,
+    // so reading it here races with nothing but request_stop().
+    std::stop_token token = job->cancel.get_token();
+    Meter outer = beginSegment(job);
+    if (job->coroutine) {
+      auto run = job->coroutine(std::move(token)).release();
+      run.promise().on_done = [this, job, due, queued]() {
+        complete(job, due, queued);
+      };
+      run.resume();
+    } else {
+      bool failed = false;
+      try {
+        job->task(std::move(token));
+      } catch (...) {
+        failed = true;
+      }
+      complete(job, due, queued, failed);
+    }
+    endSegment(outer);
+  }
+
+  // The job run executing on this thread and where its current stretch
+  // started, for CPU and allocation accounting. Runs nest when a job waits
+  // on a TaskGroup and the worker picks up another run meanwhile.
+  struct Meter {
+    CronJob *job = nullptr;
+    std::chrono::nanoseconds cpu{0};
+    std::uint64_t bytes = 0;
+  };
+
+  static Meter &meter() {
+    static thread_local Meter current;
+    return current;
+  }
+
+  // Starts charging this thread to `job`. Returns the meter of the run it
+  // interrupts, if any, after charging that run up to now.
+  Meter beginSegment(CronJob *job) {
+    Meter outer = meter();
+    if (!accounting) {
+      // park() still needs to know which job a coroutine belongs to.
+      meter().job = job;
+      return outer;
+    }
+    Meter begin{job, threadCpuTime(), threadAllocated()};
+    if (outer.job != nullptr) {
+      outer.job->run_cpu += begin.cpu - outer.cpu;
+      outer.job->run_bytes += begin.bytes - outer.bytes;
+    }
+    meter() = begin;
+    return outer;
+  }
+
+  // Goes back to charging the interrupted run. A stretch still open here
+  // belongs to a coroutine suspended on something other than sleep(), which
+  // may already be running elsewhere; it goes uncounted.
+  void endSegment(const Meter &outer) {
+    if (!accounting) {
+      meter().job = outer.job;
+      return;
+    }
+    meter() = outer.job == nullptr
+                  ? Meter{}
+                  : Meter{outer.job, threadCpuTime(), threadAllocated()};
+  }
+
+  // Charges the current stretch to its run, which is parking or finishing
+  // on this thread.
+  void closeSegment(CronJob *job) {
+    Meter &current = meter();
+    if (job == nullptr || current.job != job) {
+      return;
+    }
+    if (accounting) {
+      job->run_cpu += threadCpuTime() - current.cpu;
+      job->run_bytes += threadAllocated() - current.bytes;
+    }
+    current.job = nullptr;
+  }
+
+  // A run outlived its timeout. Called with the shard's mutex held. A plain
+  // run keeps its worker until it returns, so the executor gets a stand-in
+  // meanwhile; a coroutine run holds no worker while it waits.
+  void expire(CronJob *job) {
+    job->watchdog = CronWheel::npos;
+    job->cancel.request_stop();
+    job->state->markTimedOut();
+    if (!job->coroutine) {
+      job->timed_out = true;
+      executor.compensate();
+    }
+  }
+
+  // Asks every run in flight, queued ones included, to stop.
+  void cancelAll() {
+    std::lock_guard<std::mutex> registry(registry_mutex);
+    for (auto &entry : by_name) {
+      CronJob *job = entry.second;
+      std::lock_guard<std::mutex> lock(shardOf(job).mutex);
+      if (job->in_flight) {
+        job->cancel.request_stop();
+      }
+    }
+  }
+
+  // Waits until the only runs left in flight are coroutines parked in
+  // sleep(). False on timeout.
+  bool awaitRuns(time_point deadline) {
+    auto idle = [this]() {
+      return runs.load(std::memory_order_relaxed) <=
+             sleepers.load(std::memory_order_relaxed);
+    };
+    std::unique_lock<std::mutex> lock(drain_mutex);
+    if (deadline == time_point::max()) {
+      drain_cv.wait(lock, idle);
+      return true;
+    }
+    return drain_cv.wait_until(lock, deadline, idle);
+  }
+
+  void notifyDrain() {
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    drain_cv.notify_all();
+  }
+
+  // Frees the finished run's group slot for the best waiting run, if any.
+  void release(ConcurrencyGroup *group) {
+    std::size_t admitted;
+    {
+      std::lock_guard<std::mutex> lock(run_mutex);
+      --group->running;
+      admitted = admitWaiting(*group);
+    }
+    for (std::size_t i = 0; i < admitted; ++i) {
+      post();
+    }
+  }
+
+  // Moves waiting runs into the run queue while the group has free slots
+  // and returns how many. Called with run_mutex held; the caller submits one
+  // executor task per admitted run.
+  std::size_t admitWaiting(ConcurrencyGroup &group) {
+    std::size_t admitted = 0;
+    for (std::size_t p = 0; p < PRIORITIES; ++p) {
+      while (group.running < group.limit && !group.waiting[p].empty()) {
+        ++group.running;
+        ++admitted;
+        ready[p].push_back(group.waiting[p].front());
+        group.waiting[p].pop_front();
+      }
+    }
+    return admitted;
+  }
+
+  ConcurrencyGroup &groupOf(const std::string &name) {
+    auto &group = groups[name];
+    if (!group) {
+      group = std::make_unique<ConcurrencyGroup>();
+    }
+    return *group;
+  }
+
+  // Bookkeeping once a run has finished, on the thread that finished it.
+  void complete(CronJob *job, time_point due, time_point queued,
+                bool failed = false) {
+    auto finished = clock->now();
+    closeSegment(job);
+    recordLatency(job, due, queued, finished);
+    bool overran = advanceDeadline(job, finished);
+    persist(job);
+    finish(job, finished, overran, failed);
+  }
+
+  // Closes a coroutine run whose frame stop() destroyed while it was parked
+  // in sleep(). The run counts as finished, so the job is dispatched again
+  // after start(), or retired if it was removed meanwhile.
+  void abandon(CronJob *job) {
+    auto finished = clock->now();
+    bool overran = advanceDeadline(job, finished);
+    persist(job);
+    finish(job, finished, overran, false);
+  }
+
+  // The tail shared by complete() and abandon(): settles the run's state
+  // and group slot, then re-arms the job unless it is paused, removed or the
+  // manager has stopped.
+  void finish(CronJob *job, time_point finished, bool overran, bool failed) {
+    job->state->markFinished(finished - job->last_run, overran, failed,
+                             job->run_cpu, job->run_bytes);
+    job->run_cpu = std::chrono::nanoseconds(0);
+    job->run_bytes = 0;
+    if (job->group != nullptr) {
+      release(job->group);
+    }
+
+    {
+      Shard &shard = shardOf(job);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      if (job->watchdog != CronWheel::npos) {
+        shard.schedule.cancel(job->watchdog);
+        job->watchdog = CronWheel::npos;
+      }
+      if (job->timed_out) {
+        job->timed_out = false;
+        executor.endCompensation();
+      }
+      job->in_flight = false;
+      if (job->removed) {
+        retire(job);
+      } else if (!job->paused && running) {
+        arm(shard, job);
+        kick(shard);
+      }
+    }
+    runs.fetch_sub(1, std::memory_order_relaxed);
+    if (draining) {
+      notifyDrain();
+    }
+  }
+
+  static void recordLatency(CronJob *job, time_point due, time_point queued,
+                            time_point finished) {
+    JobHistograms *h = job->histograms.get();
+    if (h == nullptr) {
+      return;
+    }
+    h->schedule_lag.record(job->last_run - due);
+    h->queue_wait.record(job->last_run - queued);
+    h->duration.record(finished - job->last_run);
+  }
+
+  // Moves next_due past the run that just finished and reports whether the
+  // run overshot its following deadline. Interval jobs keep a fixed rate and
+  // run again at once after an overrun; cron jobs skip the fire times that
+  // passed while they were running.
+  bool advanceDeadline(CronJob *job, time_point finished) {
+    if (job->catching_up) {
+      return advanceCatchUp(job, finished);
+    }
+    if (job->cron) {
+      auto wall = clock->wall();
+      bool overran = job->cron->next(job->cron_due) < wall;
+      job->cron_due = job->cron->next(std::max(job->cron_due, wall));
+      job->next_due = CronJob::toSteady(job->cron_due, *clock);
+      return overran;
+    }
+    job->next_due += job->interval;
+    bool overran = job->next_due < finished;
+    if (overran) {
+      job->next_due = job->spread ? nextPhase(job, finished) : finished;
+    }
+    return overran;
+  }
+
+  // Replays one missed run after another; deadlines in the past fire on the
+  // next tick. Stops once the replay has reached the present.
+  bool advanceCatchUp(CronJob *job, time_point finished) {
+    if (job->cron) {
+      job->cron_due = job->cron->next(job->cron_due);
+      job->next_due = CronJob::toSteady(job->cron_due, *clock);
+      job->catching_up = job->cron_due <= clock->wall();
+    } else {
+      job->next_due += job->interval;
+      job->catching_up = job->next_due < finished;
+    }
+    return false;
+  }
+
+  // Applies a job's persisted schedule and its catch-up policy. Jobs whose
+  // next run is still ahead keep it, so a restart does not push every job a
+  // full interval back.
+  void restore(CronJob *job) {
+    ScheduleRecord &record = *job->record;
+    std::int64_t saved = record.next_due.load(std::memory_order_relaxed);
+    std::int64_t started = record.last_run.load(std::memory_order_relaxed);
+    if (started != 0) {
+      job->state->markStarted(fromNanos(started));
+    }
+    if (saved == ScheduleRecord::never) {
+      return;
+    }
+
+    auto wall = clock->wall();
+    auto due = fromNanos(saved);
+    if (due > wall) {
+      // Cron jobs already point at their next match; an interval job waits
+      // out what was left, but never longer than its current interval.
+      if (!job->cron) {
+        job->next_due =
+            std::min(job->next_due, CronJob::toSteady(due, *clock));
+      }
+      return;
+    }
+
+    switch (job->catch_up) {
+    case CatchUp::Skip:
+      if (!job->cron) {
+        auto periods = (wall - due) / job->interval + 1;
+        job->next_due =
+            CronJob::toSteady(due + periods * job->interval, *clock);
+      }
+      break;
+    case CatchUp::Once:
+      job->next_due = clock->now();
+      if (job->cron) {
+        job->cron_due = wall;
+      }
+      break;
+    case CatchUp::All:
+      job->catching_up = true;
+      job->next_due = CronJob::toSteady(due, *clock);
+      if (job->cron) {
+        job->cron_due = due;
+      }
+      break;
+    }
+  }
+
+  // Writes the job's next due time to its record: two relaxed stores into
+  // the mapping, no system call.
+  void persist(CronJob *job) {
+    if (job->record == nullptr) {
+      return;
+    }
+    std::int64_t due = ScheduleRecord::never;
+    if (job->cron) {
+      if (job->cron_due != std::chrono::system_clock::time_point::max()) {
+        due = toNanos(job->cron_due);
+      }
+    } else if (job->next_due != time_point::max()) {
+      due = toNanos(clock->wall() +
+                    std::chrono::duration_cast<
+                        std::chrono::system_clock::duration>(
+                        job->next_due - clock->now()));
+    }
+    job->record->next_due.store(due, std::memory_order_relaxed);
+  }
+
+  // Frees a removed job once it has no run in flight, and its record with
+  // it. Called with the job's shard mutex held.
+  void retire(CronJob *job) {
+    if (job->record) {
+      state->forget(job->record);
+    }
+    jobs.retire(job, job->slot);
+  }
+
+  static std::int64_t toNanos(std::chrono::system_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               t.time_since_epoch())
+        .count();
+  }
+
+  static std::chrono::system_clock::time_point fromNanos(std::int64_t ns) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(ns)));
+  }
+
+  JobTable<CronJob, JobState> jobs;
+  // Name lookup; taken before a shard's mutex, never after.
+  std::unordered_map<std::string, CronJob *> by_name;
+  std::mutex registry_mutex;
+  Clock *clock;
+  // Set when running in virtual time.
+  ManualClock *manual;
+  time_point epoch;
+  std::vector<std::unique_ptr<Shard>> shards;
+  bool pin_shards;
+  bool accounting;
+  bool record_latencies;
+  std::atomic<bool> running{false};
+  std::unique_ptr<ScheduleState> state;
+  // Descriptors watched by shard 0's event loop.
+  std::mutex watch_mutex;
+  std::unordered_map<int, std::shared_ptr<Watch>> watches;
+  // Run queue and concurrency groups; taken after a shard's mutex.
+  std::mutex run_mutex;
+  std::array<std::deque<QueuedRun>, PRIORITIES> ready;
+  std::unordered_map<std::string, std::unique_ptr<ConcurrencyGroup>> groups;
+  std::array<LatencyHistogram, PRIORITIES> class_delay;
+  // Runs dispatched and not yet complete, and coroutines parked in sleep();
+  // stop() waits on drain_cv for them to drain.
+  std::atomic<bool> draining{false};
+  std::atomic<std::size_t> runs{0};
+  std::atomic<std::size_t> sleepers{0};
+  std::mutex drain_mutex;
+  std::condition_variable drain_cv;
+  // Work posted in virtual time, run by advanceTo().
+  std::mutex deferred_mutex;
+  std::vector<CronTimer> deferred;
+  // Declared last so its workers are joined before the jobs they reference
+  // are destroyed.
+  Executor executor;
+};
@@ -0,0 +1,319 @@
+#pragma once
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Cron expression compiled to one bitmask per field.
+//
+// Accepts the standard 5 fields (minute hour day-of-month month day-of-week)
+// or 6 fields with a leading seconds field. Each field takes `*`, `?`,
+// numbers, `a-b` ranges, `/step` and comma lists; months and weekdays also
+// take three-letter names (`JAN`, `MON-FRI`), and 7 means Sunday. The
+// @yearly, @monthly, @weekly, @daily and @hourly macros are supported. As in
+// Vixie cron, when both day fields are restricted a day matching either one
+// fires.
+//
+// next() finds the following fire time with a handful of bit scans per
+// field instead of stepping minute by minute. Times are evaluated in UTC.
+class CronSchedule {
+public:
+  using time_point = std::chrono::system_clock::time_point;
+
+  static std::optional<CronSchedule> parse(const std::string &expression) {
+    std::string expr = expression;
+    if (expr == "@yearly" || expr == "@annually") {
+      expr = "0 0 1 1 *";
+    } else if (expr == "@monthly") {
+      expr = "0 0 1 * *";
+    } else if (expr == "@weekly") {
+      expr = "0 0 * * 0";
+    } else if (expr == "@daily" || expr == "@midnight") {
+      expr = "0 0 * * *";
+    } else if (expr == "@hourly") {
+      expr = "0 * * * *";
+    }
+
+    std::istringstream in(expr);
+    std::vector<std::string> fields;
+    for (std::string field; in >> field;) {
+      fields.push_back(field);
+    }
+    if (fields.size() == 5) {
+      fields.insert(fields.begin(), "0");
+    } else if (fields.size() != 6) {
+      return std::nullopt;
+    }
+
+    static const char *const months[] = {"JAN", "FEB", "MAR", "APR",
+                                         "MAY", "JUN", "JUL", "AUG",
+                                         "SEP", "OCT", "NOV", "DEC"};
+    static const char *const days[] = {"SUN", "MON", "TUE", "WED",
+                                       "THU", "FRI", "SAT"};
+    CronSchedule s;
+    std::uint64_t hours, dom, month, dow;
+    if (!parseField(fields[0], 0, 59, nullptr, 0, s.seconds) ||
+        !parseField(fields[1], 0, 59, nullptr, 0, s.minutes) ||
+        !parseField(fields[2], 0, 23, nullptr, 0, hours) ||
+        !parseField(fields[3], 1, 31, nullptr, 0, dom) ||
+        !parseField(fields[4], 1, 12, months, 1, month) ||
+        !parseField(fields[5], 0, 7, days, 0, dow)) {
+      return std::nullopt;
+    }
+    if (dow & (1u << 7)) {
+      dow = (dow | 1) & 0x7f;
+    }
+    s.hours = static_cast<std::uint32_t>(hours);
+    s.days_of_month = static_cast<std::uint32_t>(dom);
+    s.months = static_cast<std::uint16_t>(month);
+    s.days_of_week = static_cast<std::uint8_t>(dow);
+    // Like Vixie cron, a day matches either day field only when both are
+    // restricted; if either starts with `*` (including `*/2`), it must
+    // match both.
+    s.any_day_of_month = fields[3][0] == '*' || fields[3][0] == '?';
+    s.any_day_of_week = fields[5][0] == '*' || fields[5][0] == '?';
+    return s;
+  }
+
+  // First fire time strictly after `after`, or time_point::max() if the
+  // expression can never fire (for example `0 0 30 2 *`).
+  time_point next(time_point after) const {
+    auto start = std::chrono::floor<std::chrono::seconds>(after);
+    std::int64_t secs = start.time_since_epoch().count() + 1;
+    std::int64_t days = floorDiv(secs, 86400);
+    std::int64_t rest = secs - days * 86400;
+    int hour = static_cast<int>(rest / 3600);
+    int minute = static_cast<int>(rest / 60 % 60);
+    int second = static_cast<int>(rest % 60);
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+
+    const int last_year = year + 28;
+    while (year <= last_year) {
+      int m = nextBit(months, month);
+      if (m < 0) {
+        ++year, month = 1, day = 1, hour = minute = second = 0;
+        continue;
+      }
+      if (m != month) {
+        month = m, day = 1, hour = minute = second = 0;
+      }
+
+      int d = nextBit(dayMask(year, month), day);
+      if (d < 0) {
+        if (++month > 12) {
+          ++year, month = 1;
+        }
+        day = 1, hour = minute = second = 0;
+        continue;
+      }
+      if (d != day) {
+        day = d, hour = minute = second = 0;
+      }
+
+      int h = nextBit(hours, hour);
+      if (h < 0) {
+        ++day, hour = minute = second = 0;
+        continue;
+      }
+      if (h != hour) {
+        hour = h, minute = second = 0;
+      }
+
+      int mi = nextBit(minutes, minute);
+      if (mi < 0) {
+        ++hour, minute = second = 0;
+        continue;
+      }
+      if (mi != minute) {
+        minute = mi, second = 0;
+      }
+
+      int s = nextBit(seconds, second);
+      if (s < 0) {
+        ++minute, second = 0;
+        continue;
+      }
+
+      std::int64_t total = daysFromCivil(year, month, day) * 86400 +
+                           hour * 3600 + minute * 60 + s;
+      return time_point(std::chrono::seconds(total));
+    }
+    return time_point::max();
+  }
+
+  bool matches(time_point t) const {
+    std::int64_t secs =
+        std::chrono::floor<std::chrono::seconds>(t).time_since_epoch().count();
+    std::int64_t days = floorDiv(secs, 86400);
+    std::int64_t rest = secs - days * 86400;
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+    return (seconds >> (rest % 60) & 1) && (minutes >> (rest / 60 % 60) & 1) &&
+           (hours >> (rest / 3600) & 1) && (months >> month & 1) &&
+           (dayMask(year, month) >> day & 1);
+  }
+
+private:
+  CronSchedule() = default;
+
+  static bool isWildcard(const std::string &field) {
+    return field == "*" || field == "?";
+  }
+
+  static bool parseValue(const std::string &text, const char *const *names,
+                         int first_name, int &value) {
+    if (text.empty()) {
+      return false;
+    }
+    if (std::isdigit(static_cast<unsigned char>(text[0]))) {
+      value = 0;
+      for (char c : text) {
+        if (!std::isdigit(static_cast<unsigned char>(c)) || value > 1000) {
+          return false;
+        }
+        value = value * 10 + (c - '0');
+      }
+      return true;
+    }
+    if (names == nullptr || text.size() != 3) {
+      return false;
+    }
+    std::string upper;
+    for (char c : text) {
+      upper += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    int count = first_name == 1 ? 12 : 7;
+    for (int i = 0; i < count; ++i) {
+      if (upper == names[i]) {
+        value = i + first_name;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Parses one comma-separated field into a bitmask of allowed values.
+  static bool parseField(const std::string &field, int low, int high,
+                         const char *const *names, int first_name,
+                         std::uint64_t &mask) {
+    mask = 0;
+    std::size_t begin = 0;
+    while (begin <= field.size()) {
+      std::size_t end = field.find(',', begin);
+      if (end == std::string::npos) {
+        end = field.size();
+      }
+      std::string part = field.substr(begin, end - begin);
+      begin = end + 1;
+
+      int step = 1;
+      std::size_t slash = part.find('/');
+      if (slash != std::string::npos) {
+        if (!parseValue(part.substr(slash + 1), nullptr, 0, step) ||
+            step == 0) {
+          return false;
+        }
+        part.resize(slash);
+      }
+
+      int from, to;
+      std::size_t dash = part.find('-');
+      if (isWildcard(part)) {
+        from = low, to = high;
+      } else if (dash != std::string::npos) {
+        if (!parseValue(part.substr(0, dash), names, first_name, from) ||
+            !parseValue(part.substr(dash + 1), names, first_name, to)) {
+          return false;
+        }
+      } else {
+        if (!parseValue(part, names, first_name, from)) {
+          return false;
+        }
+        to = slash != std::string::npos ? high : from;
+      }
+      if (from < low || to > high || from > to) {
+        return false;
+      }
+      for (int v = from; v <= to; v += step) {
+        mask |= std::uint64_t{1} << v;
+      }
+    }
+    return mask != 0;
+  }
+
+  // Lowest set bit at or above `from`, or -1.
+  static int nextBit(std::uint64_t mask, int from) {
+    if (from > 63) {
+      return -1;
+    }
+    mask >>= from;
+    return mask == 0 ? -1 : from + __builtin_ctzll(mask);
+  }
+
+  // Days of `month` that fire, as bits 1..31, combining both day fields.
+  std::uint32_t dayMask(int year, int month) const {
+    static const int lengths[] = {31, 28, 31, 30, 31, 30,
+                                  31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    int length = lengths[month - 1] + (month == 2 && leap);
+    std::uint32_t valid = ((std::uint32_t{1} << length) - 1) << 1;
+
+    // Rotate the weekday mask so bit 0 is the 1st of the month, then repeat
+    // it across five weeks.
+    int first = weekday(daysFromCivil(year, month, 1));
+    std::uint32_t week =
+        ((days_of_week >> first) | (days_of_week << (7 - first))) & 0x7f;
+    std::uint32_t by_weekday =
+        (week | week << 7 | week << 14 | week << 21 | week << 28) << 1;
+
+    std::uint32_t days = any_day_of_month || any_day_of_week
+                             ? days_of_month & by_weekday
+                             : days_of_month | by_weekday;
+    return days & valid;
+  }
+
+  static std::int64_t floorDiv(std::int64_t a, std::int64_t b) {
+    return a / b - (a % b < 0);
+  }
+
+  // 0 = Sunday; 1970-01-01 was a Thursday.
+  static int weekday(std::int64_t days) {
+    int w = static_cast<int>((days + 4) % 7);
+    return w < 0 ? w + 7 : w;
+  }
+
+  // Days since 1970-01-01 in the proleptic Gregorian calendar.
+  static std::int64_t daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    std::int64_t era = floorDiv(y, 400);
+    std::int64_t yoe = y - era * 400;
+    std::int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    std::int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+  }
+
+  static void civilFromDays(std::int64_t z, int &y, int &m, int &d) {
+    z += 719468;
+    std::int64_t era = floorDiv(z, 146097);
+    std::int64_t doe = z - era * 146097;
+    std::int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    std::int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    std::int64_t mp = (5 * doy + 2) / 153;
+    d = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    m = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    y = static_cast<int>(yoe + era * 400 + (m <= 2));
+  }
+
+  std::uint64_t seconds = 0;
+  std::uint64_t minutes = 0;
+  std::uint32_t hours = 0;
+  std::uint32_t days_of_month = 0;
+  std::uint16_t months = 0;
+  std::uint8_t days_of_week = 0;
+  bool any_day_of_month = false;
+  bool any_day_of_week = false;
+};
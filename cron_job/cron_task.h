@@ -0,0 +1,111 @@
+#pragma once
+#include "inline_function.h"
+#include <coroutine>
+#include <exception>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+// Coroutine type for jobs that spend most of their run waiting. A job
+// returning CronTask can `co_await manager.sleep(...)`: the coroutine is
+// parked on the scheduler's timer wheel instead of holding a worker thread,
+// and resumed on the executor when the timer fires.
+//
+//   manager.addJob("poll", [&manager]() -> CronTask {
+//     co_await manager.sleep(std::chrono::milliseconds(200));
+//     poll();
+//   }, 5);
+class CronTask {
+public:
+  struct promise_type {
+    // Declared so the promise is not an aggregate; otherwise the compiler
+    // tries to build it from the coroutine's arguments.
+    promise_type() = default;
+
+    // Called once the coroutine has finished and its frame is destroyed.
+    InlineFunction<void()> on_done;
+
+    CronTask get_return_object() {
+      return CronTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+        auto done = std::move(h.promise().on_done);
+        h.destroy();
+        if (done) {
+          done();
+        }
+      }
+      void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  CronTask(CronTask &&other) noexcept
+      : handle(std::exchange(other.handle, nullptr)) {}
+  CronTask &operator=(CronTask &&other) noexcept {
+    if (this != &other) {
+      reset();
+      handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+  }
+  CronTask(const CronTask &) = delete;
+  CronTask &operator=(const CronTask &) = delete;
+
+  ~CronTask() { reset(); }
+
+  // Hands the not-yet-started coroutine over to the caller, who must resume
+  // it; the frame then frees itself when the coroutine finishes.
+  std::coroutine_handle<promise_type> release() {
+    return std::exchange(handle, nullptr);
+  }
+
+private:
+  explicit CronTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+  void reset() {
+    if (handle) {
+      handle.destroy();
+      handle = nullptr;
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+// What a job runs: either a plain callable or one returning CronTask, each
+// optionally taking a std::stop_token that is signalled when the run should
+// give up (its timeout passed or the manager is stopping). Converts
+// implicitly from any of these, so addJob takes them all. The callable is
+// stored inline, so it must fit InlineFunction's buffer.
+class JobTask {
+public:
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_same_v<std::decay_t<F>, JobTask>>>
+  JobTask(F &&f) {
+    if constexpr (std::is_invocable_v<F &, std::stop_token>) {
+      if constexpr (std::is_same_v<std::invoke_result_t<F &, std::stop_token>,
+                                   CronTask>) {
+        coroutine = std::forward<F>(f);
+      } else {
+        plain = std::forward<F>(f);
+      }
+    } else if constexpr (std::is_same_v<std::invoke_result_t<F &>, CronTask>) {
+      coroutine = [f = std::forward<F>(f)](std::stop_token) mutable {
+        return f();
+      };
+    } else {
+      plain = [f = std::forward<F>(f)](std::stop_token) mutable { f(); };
+    }
+  }
+
+  InlineFunction<void(std::stop_token)> plain;
+  InlineFunction<CronTask(std::stop_token)> coroutine;
+};
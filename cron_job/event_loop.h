@@ -0,0 +1,116 @@
+#pragma once
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <system_error>
+#include <unistd.h>
+
+// epoll set holding a timerfd for the next deadline, an eventfd to wake the
+// waiting thread, and any descriptors the caller adds (Linux only).
+//
+// The timer is armed for an absolute time on `clock`, by default
+// CLOCK_MONOTONIC, the clock behind std::chrono::steady_clock on Linux, so
+// the waiting thread wakes exactly at the deadline and not at all while
+// nothing is due. armAt() and wake() may be called from any thread while
+// another one sits in wait().
+class EventLoop {
+public:
+  explicit EventLoop(clockid_t clock = CLOCK_MONOTONIC) {
+    epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = ::timerfd_create(clock, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || timer_fd < 0 || wake_fd < 0) {
+      int error = errno;
+      closeAll();
+      throw std::system_error(error, std::generic_category(), "EventLoop");
+    }
+    add(timer_fd, EPOLLIN);
+    add(wake_fd, EPOLLIN);
+  }
+
+  EventLoop(const EventLoop &) = delete;
+  EventLoop &operator=(const EventLoop &) = delete;
+
+  ~EventLoop() { closeAll(); }
+
+  // Fires the timer at `deadline`, counted since the epoch of the loop's
+  // clock, at once if it has passed; time_point::max disarms it. Replaces
+  // any earlier deadline.
+  void armAt(std::chrono::steady_clock::time_point deadline) {
+    itimerspec spec{};
+    if (deadline != std::chrono::steady_clock::time_point::max()) {
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    deadline.time_since_epoch())
+                    .count();
+      if (ns <= 0) {
+        ns = 1; // all zeros would disarm
+      }
+      spec.it_value.tv_sec = ns / 1000000000;
+      spec.it_value.tv_nsec = ns % 1000000000;
+    }
+    ::timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+  }
+
+  void wake() {
+    std::uint64_t one = 1;
+    while (::write(wake_fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+  }
+
+  // Watches a caller's descriptor; `events` as for epoll_ctl.
+  bool add(int fd, std::uint32_t events) {
+    return control(EPOLL_CTL_ADD, fd, events);
+  }
+
+  bool modify(int fd, std::uint32_t events) {
+    return control(EPOLL_CTL_MOD, fd, events);
+  }
+
+  bool remove(int fd) { return control(EPOLL_CTL_DEL, fd, 0); }
+
+  // Blocks until the timer fires, wake() is called or a watched descriptor
+  // is ready, and calls `ready(fd, events)` for each of the latter. Returns
+  // true if the timer fired, which leaves it disarmed.
+  template <typename F> bool wait(F &&ready) {
+    epoll_event events[16];
+    int n;
+    while ((n = ::epoll_wait(epoll_fd, events, 16, -1)) < 0 &&
+           errno == EINTR) {
+    }
+    bool fired = false;
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == timer_fd || fd == wake_fd) {
+        std::uint64_t count;
+        fired |= ::read(fd, &count, sizeof(count)) > 0 && fd == timer_fd;
+      } else {
+        ready(fd, events[i].events);
+      }
+    }
+    return fired;
+  }
+
+private:
+  bool control(int op, int fd, std::uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    return ::epoll_ctl(epoll_fd, op, fd, &event) == 0;
+  }
+
+  void closeAll() {
+    for (int fd : {epoll_fd, timer_fd, wake_fd}) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+    }
+  }
+
+  int epoll_fd = -1;
+  int timer_fd = -1;
+  int wake_fd = -1;
+};
@@ -0,0 +1,430 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed-size work-stealing pool of worker threads.
+//
+// Tasks submitted from outside the pool go to a shared injection queue.
+// Tasks submitted by a running task (see TaskGroup) go to the back of the
+// current worker's own deque; the owner pops from the back, and idle workers
+// steal from the front of other workers' deques, so subtasks of a long job
+// spread across the pool instead of waiting behind it.
+//
+// A task known to be stuck can be compensated for: compensate() starts a
+// stand-in worker that keeps the pool at its usable size until
+// endCompensation() reports the task has returned, after which the extra
+// thread exits again.
+class Executor {
+public:
+  struct Stats {
+    std::uint64_t submitted;
+    std::uint64_t started;
+    std::uint64_t completed;
+    std::uint64_t stolen;
+    std::size_t queued;
+    std::chrono::nanoseconds total_queue_wait;
+    std::chrono::nanoseconds max_queue_wait;
+    std::size_t compensating; // stand-in workers for stuck tasks
+  };
+
+  explicit Executor(std::size_t workers) {
+    workers = std::max<std::size_t>(workers, 1);
+    for (std::size_t i = 0; i < workers; ++i) {
+      queues.emplace_back(std::make_unique<WorkQueue>());
+    }
+    for (std::size_t i = 0; i < workers; ++i) {
+      threads.emplace_back(&Executor::work, this, i);
+    }
+  }
+
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  ~Executor() { shutdown(); }
+
+  // The executor running the calling task, if any.
+  static Executor *current() { return worker().owner; }
+
+  void submit(std::function<void()> task) {
+    Item item{std::move(task), std::chrono::steady_clock::now()};
+    WorkQueue &queue = ownsQueue() ? *queues[worker().index] : injected;
+    submitted.fetch_add(1, std::memory_order_relaxed);
+    pending.fetch_add(1, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.items.push_back(std::move(item));
+    }
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex);
+    }
+    idle_cv.notify_one();
+  }
+
+  // Runs one queued task on the calling thread if there is any. Used by
+  // TaskGroup::wait() so a waiting job helps instead of blocking a worker.
+  bool runOne() {
+    Item item;
+    if (!take(item)) {
+      return false;
+    }
+    WorkerSlot saved = worker();
+    if (saved.owner != this) {
+      worker() = {this, helper};
+    }
+    execute(item);
+    worker() = saved;
+    return true;
+  }
+
+  // Starts a stand-in worker for one that is blocked in a task. It takes
+  // from the injection queue and steals like a regular worker.
+  void compensate() {
+    std::vector<std::thread> exited;
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex);
+      ++compensating;
+      ++stand_ins;
+      for (auto it = extra_threads.begin(); it != extra_threads.end();) {
+        if (std::find(retired.begin(), retired.end(), it->get_id()) !=
+            retired.end()) {
+          exited.push_back(std::move(*it));
+          it = extra_threads.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      retired.clear();
+      extra_threads.emplace_back(&Executor::work, this, helper);
+    }
+    for (auto &thread : exited) {
+      thread.join();
+    }
+  }
+
+  // The blocked task has returned; one stand-in exits once it is idle.
+  void endCompensation() {
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex);
+      --compensating;
+    }
+    idle_cv.notify_all();
+  }
+
+  // Runs everything already queued, then joins the workers.
+  void shutdown() {
+    std::vector<std::thread> extras;
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex);
+      stopping = true;
+      extras.swap(extra_threads);
+    }
+    idle_cv.notify_all();
+    for (auto &thread : threads) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+    for (auto &thread : extras) {
+      thread.join();
+    }
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    stand_ins = 0;
+    retired.clear();
+  }
+
+  // Starts the workers again after shutdown(); does nothing while they are
+  // running.
+  void restart() {
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex);
+      if (!stopping) {
+        return;
+      }
+      stopping = false;
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+      threads[i] = std::thread(&Executor::work, this, i);
+    }
+  }
+
+  std::size_t size() const { return threads.size(); }
+
+  Stats stats() const {
+    return {submitted.load(std::memory_order_relaxed),
+            started.load(std::memory_order_relaxed),
+            completed.load(std::memory_order_relaxed),
+            stolen.load(std::memory_order_relaxed),
+            pending.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds(
+                wait_total.load(std::memory_order_relaxed)),
+            std::chrono::nanoseconds(wait_max.load(std::memory_order_relaxed)),
+            compensatingNow()};
+  }
+
+private:
+  struct Item {
+    std::function<void()> task;
+    std::chrono::steady_clock::time_point enqueued;
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Item> items;
+  };
+
+  // Index of a thread outside the pool that is running tasks in runOne().
+  static constexpr std::size_t helper = SIZE_MAX;
+
+  struct WorkerSlot {
+    Executor *owner = nullptr;
+    std::size_t index = helper;
+  };
+
+  static WorkerSlot &worker() {
+    static thread_local WorkerSlot slot;
+    return slot;
+  }
+
+  bool ownsQueue() const {
+    return worker().owner == this && worker().index != helper;
+  }
+
+  // Stand-ins run with the helper index and own no deque. A stand-in checks
+  // whether it is still needed only between tasks, so the one that leaves
+  // may not be the one that was started for the task that returned.
+  void work(std::size_t index) {
+    worker() = {this, index};
+    while (true) {
+      Item item;
+      if (take(item)) {
+        execute(item);
+        if (index == helper && retireStandIn()) {
+          return;
+        }
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(idle_mutex);
+      idle_cv.wait(lock, [this, index]() {
+        return stopping || pending.load(std::memory_order_acquire) > 0 ||
+               (index == helper && stand_ins > compensating);
+      });
+      if (index == helper && stand_ins > compensating) {
+        --stand_ins;
+        retired.push_back(std::this_thread::get_id());
+        return;
+      }
+      if (stopping && pending.load(std::memory_order_acquire) == 0) {
+        return;
+      }
+    }
+  }
+
+  bool retireStandIn() {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    if (stand_ins > compensating) {
+      --stand_ins;
+      retired.push_back(std::this_thread::get_id());
+      return true;
+    }
+    return false;
+  }
+
+  std::size_t compensatingNow() const {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    return compensating;
+  }
+
+  // Own deque first (newest first), then the injection queue, then the
+  // oldest task of another worker.
+  bool take(Item &item) {
+    if (pending.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+    std::size_t self = queues.size();
+    if (ownsQueue()) {
+      self = worker().index;
+      if (pop(*queues[self], item, false)) {
+        return true;
+      }
+    }
+    if (pop(injected, item, true)) {
+      return true;
+    }
+    std::size_t start = self == queues.size() ? 0 : self + 1;
+    for (std::size_t i = 0; i < queues.size(); ++i) {
+      std::size_t victim = (start + i) % queues.size();
+      if (victim != self && pop(*queues[victim], item, true)) {
+        stolen.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool pop(WorkQueue &queue, Item &item, bool front) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty()) {
+      return false;
+    }
+    if (front) {
+      item = std::move(queue.items.front());
+      queue.items.pop_front();
+    } else {
+      item = std::move(queue.items.back());
+      queue.items.pop_back();
+    }
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  void execute(Item &item) {
+    recordWait(std::chrono::steady_clock::now() - item.enqueued);
+    item.task();
+    completed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void recordWait(std::chrono::nanoseconds wait) {
+    std::int64_t ns = wait.count();
+    started.fetch_add(1, std::memory_order_relaxed);
+    wait_total.fetch_add(ns, std::memory_order_relaxed);
+    std::int64_t seen = wait_max.load(std::memory_order_relaxed);
+    while (ns > seen &&
+           !wait_max.compare_exchange_weak(seen, ns,
+                                           std::memory_order_relaxed)) {
+    }
+  }
+
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  WorkQueue injected;
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> pending{0};
+  bool stopping = false;
+  // Guarded by idle_mutex. Stand-ins that have left are listed in `retired`
+  // and joined by the next compensate() or by shutdown().
+  std::size_t compensating = 0;
+  std::size_t stand_ins = 0;
+  std::vector<std::thread> extra_threads;
+  std::vector<std::thread::id> retired;
+  mutable std::mutex idle_mutex;
+  std::condition_variable idle_cv;
+  std::atomic<std::uint64_t> submitted{0};
+  std::atomic<std::uint64_t> started{0};
+  std::atomic<std::uint64_t> completed{0};
+  std::atomic<std::uint64_t> stolen{0};
+  std::atomic<std::int64_t> wait_total{0};
+  std::atomic<std::int64_t> wait_max{0};
+};
+
+// Child tasks spawned from a running job. wait() returns once every spawned
+// task has finished; while waiting, the caller runs queued tasks itself, so
+// a job fanning out over shards cannot deadlock the pool it is running on.
+// An exception thrown by a task, on whichever worker ran it, is kept and
+// rethrown by wait(); if several throw, the first one wins.
+//
+//   TaskGroup shards;
+//   for (int shard = 0; shard < 16; ++shard) {
+//     shards.spawn([shard]() { cleanup(shard); });
+//   }
+//   shards.wait();
+class TaskGroup {
+public:
+  // Binds to the executor running the calling job. Outside a worker, as
+  // under a ManualClock's advanceTo(), there is none and spawned tasks run
+  // inline on the calling thread.
+  TaskGroup() : executor(Executor::current()) {}
+  explicit TaskGroup(Executor &executor) : executor(&executor) {}
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  // Waits for the group's tasks, but drops an exception that wait() did not
+  // get to rethrow.
+  ~TaskGroup() { join(); }
+
+  void spawn(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++outstanding;
+    }
+    auto run = [this, task = std::move(task)]() {
+      std::exception_ptr thrown;
+      try {
+        task();
+      } catch (...) {
+        thrown = std::current_exception();
+      }
+      finishOne(std::move(thrown));
+    };
+    if (executor == nullptr) {
+      run();
+      return;
+    }
+    executor->submit(std::move(run));
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++spawned;
+    }
+    cv.notify_all();
+  }
+
+  // Runs queued tasks while any of the group's are outstanding, and sleeps
+  // when there is nothing to run until the group finishes or spawns more.
+  // Then rethrows the first exception a task threw, if any.
+  void wait() {
+    join();
+    std::exception_ptr thrown;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      thrown = std::exchange(error, nullptr);
+    }
+    if (thrown) {
+      std::rethrow_exception(thrown);
+    }
+  }
+
+private:
+  void join() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (outstanding > 0) {
+      std::uint64_t seen = spawned;
+      lock.unlock();
+      bool ran = executor != nullptr && executor->runOne();
+      lock.lock();
+      if (!ran) {
+        cv.wait(lock, [this, seen]() {
+          return outstanding == 0 || spawned != seen;
+        });
+      }
+    }
+  }
+
+  void finishOne(std::exception_ptr thrown) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (thrown && !error) {
+      error = std::move(thrown);
+    }
+    if (--outstanding == 0) {
+      cv.notify_all();
+    }
+  }
+
+  Executor *executor;
+  std::size_t outstanding = 0;
+  // Tasks submitted so far; a change wakes wait() to help run them.
+  std::uint64_t spawned = 0;
+  // First exception thrown by a task, until wait() rethrows it.
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
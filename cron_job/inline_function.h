@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, std::size_t Capacity = 56> class InlineFunction;
+
+// Move-only std::function replacement that stores the callable in a fixed
+// inline buffer and never allocates. A callable that does not fit is a
+// compile error rather than a silent heap allocation; capture large state by
+// reference or through a pointer. The default capacity makes the whole
+// object one cache line.
+template <typename R, typename... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+public:
+  InlineFunction() = default;
+
+  template <typename F,
+            typename = std::enable_if_t<
+                !std::is_same_v<std::decay_t<F>, InlineFunction> &&
+                std::is_invocable_r_v<R, std::decay_t<F> &, Args...>>>
+  InlineFunction(F &&f) {
+    using Fn = std::decay_t<F>;
+    static_assert(sizeof(Fn) <= Capacity,
+                  "callable too large for InlineFunction; capture less");
+    static_assert(alignof(Fn) <= alignof(std::max_align_t),
+                  "callable over-aligned for InlineFunction");
+    static_assert(std::is_nothrow_move_constructible_v<Fn>,
+                  "InlineFunction needs a nothrow-movable callable");
+    ::new (static_cast<void *>(storage)) Fn(std::forward<F>(f));
+    ops = &opsFor<Fn>;
+  }
+
+  InlineFunction(InlineFunction &&other) noexcept { moveFrom(other); }
+
+  InlineFunction &operator=(InlineFunction &&other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  InlineFunction(const InlineFunction &) = delete;
+  InlineFunction &operator=(const InlineFunction &) = delete;
+
+  ~InlineFunction() { reset(); }
+
+  explicit operator bool() const { return ops != nullptr; }
+
+  R operator()(Args... args) {
+    return ops->invoke(storage, std::forward<Args>(args)...);
+  }
+
+private:
+  struct Ops {
+    R (*invoke)(void *, Args &&...);
+    void (*relocate)(void *, void *);
+    void (*destroy)(void *);
+  };
+
+  template <typename Fn>
+  static constexpr Ops opsFor = {
+      [](void *self, Args &&...args) -> R {
+        return (*static_cast<Fn *>(self))(std::forward<Args>(args)...);
+      },
+      [](void *to, void *from) {
+        ::new (to) Fn(std::move(*static_cast<Fn *>(from)));
+        static_cast<Fn *>(from)->~Fn();
+      },
+      [](void *self) { static_cast<Fn *>(self)->~Fn(); }};
+
+  void moveFrom(InlineFunction &other) {
+    if (other.ops != nullptr) {
+      other.ops->relocate(storage, other.storage);
+      ops = other.ops;
+      other.ops = nullptr;
+    }
+  }
+
+  void reset() {
+    if (ops != nullptr) {
+      ops->destroy(storage);
+      ops = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage[Capacity];
+  const Ops *ops = nullptr;
+};
@@ -0,0 +1,163 @@
+#pragma once
+#include "executor.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timing of one run of a JobGraph.
+struct GraphRun {
+  struct Node {
+    std::string name;
+    std::chrono::nanoseconds start;    // since the run began
+    std::chrono::nanoseconds duration;
+  };
+
+  std::chrono::nanoseconds wall{0};
+  // Longest chain of dependent node durations: the shortest the run could
+  // take with unlimited workers. Much less than `wall` means the nodes
+  // queued behind other work.
+  std::chrono::nanoseconds critical_path{0};
+  // Names along that chain, first to last.
+  std::vector<std::string> path;
+  std::vector<Node> nodes;
+};
+
+// Jobs with dependencies between them, run as one unit:
+//
+//   auto etl = std::make_shared<JobGraph>();
+//   auto extract = etl->add("extract", extractAll);
+//   auto a = etl->add("compress a", compressA, {extract});
+//   auto b = etl->add("compress b", compressB, {extract});
+//   etl->add("publish", publish, {a, b});
+//   manager.addJob("etl", [etl]() { etl->run(); }, 3600);
+//
+// Dependencies must be added first, so the graph cannot have cycles and
+// insertion order is a topological order. run() starts every node as soon
+// as the last of its inputs finishes; independent branches run in parallel
+// on the executor running the caller, which helps with the work while it
+// waits.
+class JobGraph {
+public:
+  using NodeId = std::size_t;
+
+  NodeId add(std::string name, std::function<void()> task,
+             std::vector<NodeId> inputs = {}) {
+    NodeId id = nodes.size();
+    for (NodeId input : inputs) {
+      nodes.at(input).outputs.push_back(id);
+    }
+    nodes.push_back({std::move(name), std::move(task), std::move(inputs), {}});
+    return id;
+  }
+
+  std::size_t size() const { return nodes.size(); }
+
+  // Runs every node once. Outside an executor the nodes run one after the
+  // other on the calling thread. The graph must not change during a run.
+  void run() {
+    using clock = std::chrono::steady_clock;
+    std::vector<clock::time_point> started(nodes.size());
+    std::vector<clock::time_point> finished(nodes.size());
+    auto begin = clock::now();
+
+    auto execute = [&](NodeId id) {
+      started[id] = clock::now();
+      nodes[id].task();
+      finished[id] = clock::now();
+    };
+
+    if (Executor *executor = Executor::current()) {
+      std::unique_ptr<std::atomic<std::size_t>[]> waiting(
+          new std::atomic<std::size_t>[nodes.size()]);
+      for (NodeId id = 0; id < nodes.size(); ++id) {
+        waiting[id].store(nodes[id].inputs.size(), std::memory_order_relaxed);
+      }
+      TaskGroup group(*executor);
+      std::function<void(NodeId)> start = [&](NodeId id) {
+        group.spawn([&, id]() {
+          execute(id);
+          for (NodeId next : nodes[id].outputs) {
+            if (waiting[next].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+              start(next);
+            }
+          }
+        });
+      };
+      for (NodeId id = 0; id < nodes.size(); ++id) {
+        if (nodes[id].inputs.empty()) {
+          start(id);
+        }
+      }
+      group.wait();
+    } else {
+      for (NodeId id = 0; id < nodes.size(); ++id) {
+        execute(id);
+      }
+    }
+
+    GraphRun report = summarize(begin, started, finished);
+    std::lock_guard<std::mutex> lock(mutex);
+    last = std::move(report);
+  }
+
+  // Timing of the most recent run; empty before the first.
+  GraphRun lastRun() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return last;
+  }
+
+private:
+  struct Node {
+    std::string name;
+    std::function<void()> task;
+    std::vector<NodeId> inputs;
+    std::vector<NodeId> outputs;
+  };
+
+  // Longest path by node duration, computed in insertion order.
+  GraphRun
+  summarize(std::chrono::steady_clock::time_point begin,
+            const std::vector<std::chrono::steady_clock::time_point> &started,
+            const std::vector<std::chrono::steady_clock::time_point> &finished)
+      const {
+    GraphRun report;
+    std::vector<std::chrono::nanoseconds> longest(nodes.size());
+    std::vector<NodeId> via(nodes.size(), nodes.size());
+    NodeId tail = nodes.size();
+    for (NodeId id = 0; id < nodes.size(); ++id) {
+      auto duration = finished[id] - started[id];
+      report.nodes.push_back({nodes[id].name, started[id] - begin, duration});
+      report.wall = std::max<std::chrono::nanoseconds>(report.wall,
+                                                       finished[id] - begin);
+      for (NodeId input : nodes[id].inputs) {
+        if (via[id] == nodes.size() || longest[input] > longest[via[id]]) {
+          via[id] = input;
+        }
+      }
+      longest[id] = duration + (via[id] == nodes.size()
+                                    ? std::chrono::nanoseconds(0)
+                                    : longest[via[id]]);
+      if (tail == nodes.size() || longest[id] > longest[tail]) {
+        tail = id;
+      }
+    }
+    if (tail != nodes.size()) {
+      report.critical_path = longest[tail];
+      for (NodeId id = tail; id != nodes.size(); id = via[id]) {
+        report.path.push_back(nodes[id].name);
+      }
+      std::reverse(report.path.begin(), report.path.end());
+    }
+    return report;
+  }
+
+  std::vector<Node> nodes;
+  mutable std::mutex mutex;
+  GraphRun last;
+};
@@ -0,0 +1,232 @@
+#pragma once
+#include "latency_histogram.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Point-in-time view of one job, as returned by CronJobManager::status().
+struct JobStatus {
+  std::string name;
+  bool running;
+  bool paused;
+  std::chrono::system_clock::time_point last_start;
+  std::chrono::nanoseconds last_duration;
+  std::uint64_t run_count;
+  std::uint64_t overruns;
+  // Runs that outlived JobOptions::timeout and were asked to stop.
+  std::uint64_t timeouts;
+  // Runs that ended by throwing; they count in run_count too.
+  std::uint64_t failures;
+  // time_point::max() when the job is not scheduled to run again.
+  std::chrono::steady_clock::time_point next_due;
+  // Totals over all finished runs: CPU time of the threads that ran them,
+  // start-to-finish time, and bytes allocated (see resource_usage.h).
+  // CPU and bytes stay zero with CronJobManager::Options::accounting off.
+  std::chrono::nanoseconds cpu_time;
+  std::chrono::nanoseconds run_time;
+  std::uint64_t allocated;
+};
+
+// Aggregate over all jobs, as returned by CronJobManager::summary().
+struct JobSummary {
+  std::size_t jobs = 0;
+  std::size_t running = 0;
+  std::size_t paused = 0;
+  std::chrono::steady_clock::time_point next_due =
+      std::chrono::steady_clock::time_point::max();
+};
+
+// Latency distributions of one job, as returned by
+// CronJobManager::latencies(). `interval` is zero for cron-expression jobs.
+struct JobLatency {
+  std::string name;
+  std::chrono::milliseconds interval;
+  LatencyHistogram::Snapshot schedule_lag; // due time to start of the run
+  LatencyHistogram::Snapshot queue_wait;   // handed to the executor to start
+  LatencyHistogram::Snapshot duration;     // start to finish
+};
+
+// Dispatch order of jobs that are due at the same time: when workers are
+// busy, queued High jobs start before Normal ones and Normal before Low.
+enum class Priority { High, Normal, Low };
+constexpr std::size_t PRIORITIES = 3;
+
+// Time jobs of one priority class spent between coming due and starting, as
+// returned by CronJobManager::classLatencies().
+struct ClassLatency {
+  Priority priority;
+  LatencyHistogram::Snapshot queue_delay;
+};
+
+// Recording side of JobLatency. Allocated when the job is added, so the
+// worker finishing each run, its only writer, never allocates.
+struct JobHistograms {
+  LatencyHistogram schedule_lag;
+  LatencyHistogram queue_wait;
+  LatencyHistogram duration;
+};
+
+// Per-job run state behind a seqlock. Writers (the scheduler when it
+// dispatches the job, the worker running it, and pause/resume calls) take
+// turns by flipping the sequence to odd; readers never block a writer and
+// retry if a write overlapped their copy. Fields are relaxed atomics so the
+// racing reads are well defined.
+//
+// These are the fields a status scan reads, so the job table keeps them in
+// contiguous arrays beside the job pointers (see JobTable) instead of inside
+// each job.
+class JobState {
+public:
+  bool running() const { return running_.load(std::memory_order_relaxed); }
+
+  // Clears a reused table slot for a new job.
+  void reset() {
+    write([&]() {
+      running_.store(false, std::memory_order_relaxed);
+      paused_.store(false, std::memory_order_relaxed);
+      last_start.store(0, std::memory_order_relaxed);
+      last_duration.store(0, std::memory_order_relaxed);
+      run_count.store(0, std::memory_order_relaxed);
+      overruns.store(0, std::memory_order_relaxed);
+      timeouts.store(0, std::memory_order_relaxed);
+      failures.store(0, std::memory_order_relaxed);
+      next_due.store(never, std::memory_order_relaxed);
+      cpu_time.store(0, std::memory_order_relaxed);
+      run_time.store(0, std::memory_order_relaxed);
+      allocated.store(0, std::memory_order_relaxed);
+    });
+  }
+
+  bool paused() const { return paused_.load(std::memory_order_relaxed); }
+
+  std::chrono::steady_clock::time_point nextDue() const {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(
+            next_due.load(std::memory_order_relaxed)));
+  }
+
+  // Called whenever the job is armed for its next run.
+  void setNextDue(std::chrono::steady_clock::time_point due) {
+    write([&]() {
+      next_due.store(due.time_since_epoch().count(),
+                     std::memory_order_relaxed);
+    });
+  }
+
+  void setPaused(bool value) {
+    write([&]() { paused_.store(value, std::memory_order_relaxed); });
+  }
+
+  // Called by the scheduler when the job is handed to the executor.
+  void markDispatched() {
+    write([&]() { running_.store(true, std::memory_order_relaxed); });
+  }
+
+  void markStarted(std::chrono::system_clock::time_point start) {
+    write([&]() {
+      last_start.store(start.time_since_epoch().count(),
+                       std::memory_order_relaxed);
+    });
+  }
+
+  // Called by the scheduler when a run exceeds its timeout.
+  void markTimedOut() {
+    write([&]() {
+      timeouts.store(timeouts.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+    });
+  }
+
+  // `overran` is set when the run took longer than the job's interval,
+  // `failed` when it threw. `cpu` and `bytes` are what the run used.
+  void markFinished(std::chrono::nanoseconds duration, bool overran,
+                    bool failed, std::chrono::nanoseconds cpu,
+                    std::uint64_t bytes) {
+    write([&]() {
+      running_.store(false, std::memory_order_relaxed);
+      last_duration.store(duration.count(), std::memory_order_relaxed);
+      add(run_time, duration.count());
+      add(cpu_time, cpu.count());
+      add(allocated, bytes);
+      run_count.store(run_count.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+      if (overran) {
+        overruns.store(overruns.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+      }
+      if (failed) {
+        failures.store(failures.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+      }
+    });
+  }
+
+  // Copies a consistent set of fields into `out` (everything but the name).
+  void read(JobStatus &out) const {
+    while (true) {
+      std::uint64_t before = sequence.load(std::memory_order_acquire);
+      if (before & 1) {
+        continue;
+      }
+      out.running = running_.load(std::memory_order_relaxed);
+      out.paused = paused_.load(std::memory_order_relaxed);
+      out.last_start = std::chrono::system_clock::time_point(
+          std::chrono::system_clock::duration(
+              last_start.load(std::memory_order_relaxed)));
+      out.last_duration = std::chrono::nanoseconds(
+          last_duration.load(std::memory_order_relaxed));
+      out.run_count = run_count.load(std::memory_order_relaxed);
+      out.overruns = overruns.load(std::memory_order_relaxed);
+      out.timeouts = timeouts.load(std::memory_order_relaxed);
+      out.failures = failures.load(std::memory_order_relaxed);
+      out.next_due = nextDue();
+      out.cpu_time =
+          std::chrono::nanoseconds(cpu_time.load(std::memory_order_relaxed));
+      out.run_time =
+          std::chrono::nanoseconds(run_time.load(std::memory_order_relaxed));
+      out.allocated = allocated.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) == before) {
+        return;
+      }
+    }
+  }
+
+private:
+  static constexpr std::chrono::steady_clock::rep never =
+      std::chrono::steady_clock::time_point::max().time_since_epoch().count();
+
+  // Only called inside write(), so the load and store do not race.
+  template <typename T> static void add(std::atomic<T> &total, T amount) {
+    total.store(total.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+  }
+
+  template <typename F> void write(F &&update) {
+    std::uint64_t seq = sequence.load(std::memory_order_relaxed);
+    while ((seq & 1) ||
+           !sequence.compare_exchange_weak(seq, seq + 1,
+                                           std::memory_order_acquire)) {
+      seq = sequence.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    update();
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  std::atomic<std::uint64_t> sequence{0};
+  std::atomic<bool> running_{false};
+  std::atomic<bool> paused_{false};
+  std::atomic<std::chrono::system_clock::rep> last_start{0};
+  std::atomic<std::int64_t> last_duration{0};
+  std::atomic<std::uint64_t> run_count{0};
+  std::atomic<std::uint64_t> overruns{0};
+  std::atomic<std::uint64_t> timeouts{0};
+  std::atomic<std::uint64_t> failures{0};
+  std::atomic<std::chrono::steady_clock::rep> next_due{never};
+  std::atomic<std::int64_t> cpu_time{0};
+  std::atomic<std::int64_t> run_time{0};
+  std::atomic<std::uint64_t> allocated{0};
+};
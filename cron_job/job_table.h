@@ -0,0 +1,198 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Table of jobs that readers walk without taking a lock while writers add and
+// remove jobs concurrently.
+//
+// Jobs live in fixed-size chunks that are never moved, so a reader that has
+// loaded the published size can visit every slot below it; slots are
+// published and cleared with release/acquire atomics. Writers serialize on
+// an internal mutex that readers never touch.
+//
+// Each slot also has a `Hot` record holding the fields a full scan reads.
+// Hot records sit in an array per chunk, contiguous and apart from the jobs
+// themselves, so forEachHot() walks plain arrays instead of chasing a
+// pointer per job into its cold data (name, callable, schedule).
+//
+// Removed jobs are reclaimed by epoch: a reader announces itself on one of
+// two counters picked by the current epoch's parity, and the epoch only moves
+// forward once the counter of the previous parity has drained. A job retired
+// at epoch e can therefore be deleted once the epoch reaches e + 2, without a
+// writer ever waiting on a reader. Its slot, and with it the slot's hot
+// record, is only handed to a new job at that point too, so a removed job
+// that is still running never shares a record with its successor.
+template <typename Job, typename Hot> class JobTable {
+public:
+  static constexpr std::size_t CHUNK = 4096;
+  static constexpr std::size_t MAX_CHUNKS = 4096;
+
+  JobTable() = default;
+  JobTable(const JobTable &) = delete;
+  JobTable &operator=(const JobTable &) = delete;
+
+  ~JobTable() {
+    for (auto &chunk : chunks) {
+      Chunk *c = chunk.load(std::memory_order_relaxed);
+      if (c == nullptr) {
+        break;
+      }
+      for (auto &slot : c->jobs) {
+        delete slot.load(std::memory_order_relaxed);
+      }
+      delete c;
+    }
+    for (auto &entry : retired) {
+      delete entry.job;
+    }
+  }
+
+  // Takes ownership of `job` and returns its slot. `prepare(job, hot)` runs
+  // before the job becomes visible to readers, to reset the slot's hot
+  // record and link the job to it.
+  template <typename F>
+  std::size_t add(std::unique_ptr<Job> job, F &&prepare) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t slot;
+    if (!free_slots.empty()) {
+      slot = free_slots.back();
+      free_slots.pop_back();
+    } else {
+      slot = count.load(std::memory_order_relaxed);
+      auto &chunk = chunks.at(slot / CHUNK);
+      if (chunk.load(std::memory_order_relaxed) == nullptr) {
+        chunk.store(new Chunk{}, std::memory_order_release);
+      }
+      count.store(slot + 1, std::memory_order_release);
+    }
+    prepare(*job, hot(slot));
+    at(slot).store(job.release(), std::memory_order_release);
+    collect();
+    return slot;
+  }
+
+  // Hides the job in `slot` from new readers. The job stays alive, owned by
+  // the caller, and keeps the slot and its hot record until it is passed to
+  // retire().
+  Job *remove(std::size_t slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return at(slot).exchange(nullptr, std::memory_order_acq_rel);
+  }
+
+  // Deletes a removed job, and frees its slot for reuse, once no reader can
+  // still be looking at it.
+  void retire(Job *job, std::size_t slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    retired.push_back({epoch.load(std::memory_order_seq_cst), job, slot});
+    collect();
+  }
+
+  std::size_t size() const { return count.load(std::memory_order_acquire); }
+
+  // Slots never move, so the reference stays valid for the table's life.
+  Hot &hot(std::size_t slot) {
+    Chunk *chunk = chunks[slot / CHUNK].load(std::memory_order_acquire);
+    return chunk->hot[slot % CHUNK];
+  }
+
+  template <typename F> void forEach(F &&visit) const {
+    std::uint64_t entered = enter();
+    std::size_t n = size();
+    for (std::size_t slot = 0; slot < n; ++slot) {
+      if (Job *job = at(slot).load(std::memory_order_acquire)) {
+        visit(*job);
+      }
+    }
+    leave(entered);
+  }
+
+  // Visits the hot record of every occupied slot, chunk by chunk. A slot
+  // being reused may show the new job's freshly reset record.
+  template <typename F> void forEachHot(F &&visit) const {
+    std::size_t n = size();
+    for (std::size_t base = 0; base < n; base += CHUNK) {
+      const Chunk &chunk =
+          *chunks[base / CHUNK].load(std::memory_order_acquire);
+      std::size_t end = std::min(CHUNK, n - base);
+      for (std::size_t i = 0; i < end; ++i) {
+        if (chunk.jobs[i].load(std::memory_order_relaxed) != nullptr) {
+          visit(chunk.hot[i]);
+        }
+      }
+    }
+  }
+
+private:
+  struct Retired {
+    std::uint64_t epoch;
+    Job *job;
+    std::size_t slot;
+  };
+
+  struct Chunk {
+    std::array<std::atomic<Job *>, CHUNK> jobs{};
+    std::array<Hot, CHUNK> hot;
+  };
+
+  std::atomic<Job *> &at(std::size_t slot) const {
+    Chunk *chunk = chunks[slot / CHUNK].load(std::memory_order_acquire);
+    return chunk->jobs[slot % CHUNK];
+  }
+
+  std::uint64_t enter() const {
+    while (true) {
+      std::uint64_t e = epoch.load(std::memory_order_seq_cst);
+      readers[e & 1].fetch_add(1, std::memory_order_seq_cst);
+      if (epoch.load(std::memory_order_seq_cst) == e) {
+        return e;
+      }
+      readers[e & 1].fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  void leave(std::uint64_t entered) const {
+    readers[entered & 1].fetch_sub(1, std::memory_order_release);
+  }
+
+  // Advances the epoch if the previous one has no readers left and deletes
+  // what is old enough. Called with the writer mutex held.
+  void collect() {
+    if (retired.empty()) {
+      return;
+    }
+    for (int step = 0; step < 2; ++step) {
+      std::uint64_t e = epoch.load(std::memory_order_seq_cst);
+      if (readers[(e + 1) & 1].load(std::memory_order_seq_cst) != 0) {
+        break;
+      }
+      epoch.store(e + 1, std::memory_order_seq_cst);
+    }
+    std::uint64_t e = epoch.load(std::memory_order_seq_cst);
+    std::size_t kept = 0;
+    for (auto &entry : retired) {
+      if (entry.epoch + 2 <= e) {
+        delete entry.job;
+        free_slots.push_back(entry.slot);
+      } else {
+        retired[kept++] = entry;
+      }
+    }
+    retired.resize(kept);
+  }
+
+  std::array<std::atomic<Chunk *>, MAX_CHUNKS> chunks{};
+  std::atomic<std::size_t> count{0};
+  std::vector<std::size_t> free_slots;
+  std::vector<Retired> retired;
+  std::atomic<std::uint64_t> epoch{0};
+  mutable std::array<std::atomic<std::int64_t>, 2> readers{};
+  std::mutex mutex;
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Log-linear (HDR-style) histogram of durations in microseconds.
+//
+// Values below 8 us get their own bucket; above that each power of two is
+// split into 8 sub-buckets, so any recorded value is reported within 12.5%.
+// The range tops out at about 71 minutes; longer values land in the last
+// bucket. Counters are relaxed atomics written with a plain load and store:
+// a histogram belongs to one job, and a job's runs never overlap, so there is
+// only ever one writer and recording is allocation-free and uncontended.
+class LatencyHistogram {
+public:
+  static constexpr int SUB_BITS = 3;
+  static constexpr int SUB = 1 << SUB_BITS;
+  static constexpr int MAX_BIT = 31;
+  static constexpr int BUCKETS = SUB + (MAX_BIT - SUB_BITS + 1) * SUB;
+
+  // Plain copy of the counters, safe to inspect at leisure.
+  class Snapshot {
+  public:
+    std::uint64_t count() const { return total; }
+
+    // Upper bound of the bucket holding the q-th quantile (0 <= q <= 1).
+    std::chrono::microseconds quantile(double q) const {
+      if (total == 0) {
+        return std::chrono::microseconds(0);
+      }
+      auto rank = static_cast<std::uint64_t>(q * (total - 1)) + 1;
+      std::uint64_t seen = 0;
+      for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+          return std::chrono::microseconds(upperBound(i));
+        }
+      }
+      return std::chrono::microseconds(upperBound(BUCKETS - 1));
+    }
+
+    std::chrono::microseconds max() const { return quantile(1.0); }
+
+  private:
+    friend class LatencyHistogram;
+    std::array<std::uint32_t, BUCKETS> counts{};
+    std::uint64_t total = 0;
+  };
+
+  void record(std::chrono::nanoseconds value) {
+    auto us = value.count() < 0 ? 0 : value.count() / 1000;
+    auto &counter = counts[bucket(static_cast<std::uint64_t>(us))];
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+  }
+
+  Snapshot snapshot() const {
+    Snapshot s;
+    for (int i = 0; i < BUCKETS; ++i) {
+      s.counts[i] = counts[i].load(std::memory_order_relaxed);
+      s.total += s.counts[i];
+    }
+    return s;
+  }
+
+private:
+  static int bucket(std::uint64_t us) {
+    if (us < SUB) {
+      return static_cast<int>(us);
+    }
+    int bit = std::min(63 - __builtin_clzll(us), MAX_BIT);
+    if (bit == MAX_BIT && us >> MAX_BIT >= 2) {
+      return BUCKETS - 1;
+    }
+    int sub = static_cast<int>((us >> (bit - SUB_BITS)) & (SUB - 1));
+    return SUB + (bit - SUB_BITS) * SUB + sub;
+  }
+
+  static std::uint64_t upperBound(int index) {
+    if (index < SUB) {
+      return index;
+    }
+    int bit = (index - SUB) / SUB + SUB_BITS;
+    std::uint64_t sub = (index - SUB) % SUB;
+    return (std::uint64_t{1} << bit) + ((sub + 1) << (bit - SUB_BITS)) - 1;
+  }
+
+  std::array<std::atomic<std::uint32_t>, BUCKETS> counts{};
+};
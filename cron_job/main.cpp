@@ -1,119 +1,8 @@
-#include <atomic>
+#include "cron_job_manager.h"
 #include <chrono>
-#include <condition_variable>
-#include <functional>
-#include <iomanip>
 #include <iostream>
-#include <memory>
-#include <mutex>
-#include <sstream>
 #include <string>
 #include <thread>
-#include <vector>
-
-class CronJob {
-public:
-  CronJob(std::string name, std::function<void()> task, int interval_seconds)
-      : name(std::move(name)), task(std::move(task)),
-        interval_seconds(interval_seconds), is_running(false),
-        last_run(std::chrono::steady_clock::now()) {}
-
-  // Delete copy constructor and assignment operator
-  CronJob(const CronJob &) = delete;
-  CronJob &operator=(const CronJob &) = delete;
-
-  // Implement move constructor and assignment operator
-  CronJob(CronJob &&other) noexcept
-      : name(std::move(other.name)), task(std::move(other.task)),
-        interval_seconds(other.interval_seconds),
-        is_running(other.is_running.load()), last_run(other.last_run) {}
-
-  CronJob &operator=(CronJob &&other) noexcept {
-    if (this != &other) {
-      name = std::move(other.name);
-      task = std::move(other.task);
-      interval_seconds = other.interval_seconds;
-      is_running = other.is_running.load();
-      last_run = other.last_run;
-    }
-    return *this;
-  }
-
-  std::string name;
-  std::function<void()> task;
-  int interval_seconds;
-  std::atomic<bool> is_running;
-  std::chrono::steady_clock::time_point last_run;
-};
-
-class CronJobManager {
-public:
-  void addJob(std::string name, std::function<void()> task,
-              int interval_seconds) {
-    jobs.emplace_back(std::make_unique<CronJob>(
-        std::move(name), std::move(task), interval_seconds));
-  }
-
-  void start() {
-    running = true;
-    worker_thread = std::thread(&CronJobManager::run, this);
-  }
-
-  void stop() {
-    running = false;
-    cv.notify_all();
-    if (worker_thread.joinable()) {
-      worker_thread.join();
-    }
-  }
-
-  void printStatus() {
-    std::lock_guard<std::mutex> lock(mutex);
-    auto now = std::chrono::system_clock::now();
-    auto now_c = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&now_c), "%Y-%m-%d %H:%M:%S");
-
-    std::cout << "Current status at " << ss.str() << ":\n";
-    for (const auto &job : jobs) {
-      std::cout << job->name << ": "
-                << (job->is_running ? "Running" : "Not running") << "\n";
-    }
-    std::cout << std::endl;
-  }
-
-private:
-  void run() {
-    while (running) {
-      auto now = std::chrono::steady_clock::now();
-
-      for (auto &job : jobs) {
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                           now - job->last_run)
-                           .count();
-        if (!job->is_running && elapsed >= job->interval_seconds) {
-          std::thread([this, &job, now]() {
-            job->is_running = true;
-            job->task();
-            job->is_running = false;
-            job->last_run = now;
-            cv.notify_all();
-          }).detach();
-        }
-      }
-
-      std::unique_lock<std::mutex> lock(mutex);
-      cv.wait_until(lock, now + std::chrono::seconds(1),
-                    [this]() { return !running; });
-    }
-  }
-
-  std::vector<std::unique_ptr<CronJob>> jobs;
-  std::atomic<bool> running{false};
-  std::thread worker_thread;
-  std::mutex mutex;
-  std::condition_variable cv;
-};
 
 // Example usage
 int main() {
@@ -135,12 +24,52 @@ int main() {
       },
       3);
 
+  manager.addJob(
+      "Job 3",
+      []() {
+        std::cout << "Executing Job 3\n";
+        TaskGroup shards;
+        for (int shard = 0; shard < 4; ++shard) {
+          shards.spawn([shard]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            std::cout << "Job 3 cleaned shard " + std::to_string(shard) + "\n";
+          });
+        }
+        shards.wait();
+      },
+      10);
+
+  // Every 5 seconds, on the wall clock.
+  manager.addJob(
+      "Job 4", []() { std::cout << "Executing Job 4\n"; },
+      *CronSchedule::parse("*/5 * * * * *"));
+
+  // Waits on the scheduler's timers without holding a worker thread.
+  manager.addJob(
+      "Job 5",
+      [&manager]() -> CronTask {
+        std::cout << "Job 5 waiting for data\n";
+        co_await manager.sleep(std::chrono::seconds(2));
+        std::cout << "Job 5 done\n";
+      },
+      8);
+
   manager.start();
 
-  // Run for 60 seconds
+  // Run for 60 seconds, changing the job set while the scheduler runs
   for (int i = 0; i < 60; ++i) {
     std::this_thread::sleep_for(std::chrono::seconds(1));
+    if (i == 20) {
+      manager.pauseJob("Job 2");
+    } else if (i == 30) {
+      manager.removeJob("Job 3");
+    } else if (i == 40) {
+      manager.resumeJob("Job 2");
+    }
     manager.printStatus();
+    if (i % 10 == 9) {
+      manager.printLatencies();
+    }
   }
 
   manager.stop();
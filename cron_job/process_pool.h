@@ -0,0 +1,438 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Pre-forked worker processes for jobs that should not share the scheduler's
+// address space: ones that load large native libraries, leak, or may crash
+// (Linux only).
+//
+// The tasks are fixed when the pool is created, because a worker can only
+// run code that was in the process image it was forked from. The
+// constructor forks a fork server first, a single-threaded copy of the
+// process that holds the tasks and forks each worker on request. Workers
+// therefore never inherit a lock some other thread held at the time of the
+// fork, even when they are respawned while the scheduler is running, but
+// the pool itself must be created before any other thread is started:
+//
+//   int main() {
+//     ProcessPool pool({{"render", renderThumbnails}});
+//     CronJobManager manager;
+//     manager.addJob("thumbnails", pool.task("render"), 60);
+//     manager.start();
+//     ...
+//   }
+//
+// Each worker talks to the pool over its own SOCK_SEQPACKET socket pair: a
+// run sends the task index and blocks the calling thread until the worker
+// replies. A worker that dies mid-run is replaced in the background by a
+// fresh one, and with `max_runs` set a worker is retired after that many
+// runs, which bounds how much a leaking task can accumulate.
+class ProcessPool {
+public:
+  using Tasks = std::vector<std::pair<std::string, std::function<void()>>>;
+
+  struct Options {
+    std::size_t processes = 2;
+    // Runs after which a worker is replaced; zero for never.
+    std::size_t max_runs = 0;
+  };
+
+  enum class Outcome {
+    Done,   // the task returned
+    Failed, // the task threw
+    Lost,   // the worker died or was killed, or none could be started
+  };
+
+  struct Result {
+    Outcome outcome;
+    std::chrono::nanoseconds run_time; // measured in the worker
+  };
+
+  struct Stats {
+    std::size_t processes;
+    std::uint64_t runs;
+    std::uint64_t failed;
+    std::uint64_t lost;
+    std::uint64_t respawned;
+  };
+
+  // Throws std::system_error if the fork server or a worker cannot be
+  // started.
+  explicit ProcessPool(Tasks tasks) : ProcessPool(std::move(tasks), {}) {}
+
+  ProcessPool(Tasks tasks, const Options &options)
+      : tasks(std::move(tasks)), options(options) {
+    int pair[2];
+    if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0) {
+      throw std::system_error(errno, std::generic_category(), "ProcessPool");
+    }
+    server = ::fork();
+    if (server < 0) {
+      int error = errno;
+      ::close(pair[0]);
+      ::close(pair[1]);
+      throw std::system_error(error, std::generic_category(), "ProcessPool");
+    }
+    if (server == 0) {
+      ::close(pair[0]);
+      serveForks(pair[1]);
+    }
+    ::close(pair[1]);
+    control = pair[0];
+
+    for (std::size_t i = 0; i < std::max<std::size_t>(options.processes, 1);
+         ++i) {
+      Worker worker;
+      if (!spawn(worker)) {
+        int error = errno;
+        shutdown();
+        throw std::system_error(error, std::generic_category(),
+                                "ProcessPool worker");
+      }
+      idle.push_back(worker);
+      ++live;
+    }
+    respawner = std::thread(&ProcessPool::respawn, this);
+  }
+
+  ProcessPool(const ProcessPool &) = delete;
+  ProcessPool &operator=(const ProcessPool &) = delete;
+
+  // Must not overlap with a run.
+  ~ProcessPool() { shutdown(); }
+
+  // Index of the task registered as `name`; throws std::out_of_range.
+  std::size_t find(const std::string &name) const {
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+      if (tasks[i].first == name) {
+        return i;
+      }
+    }
+    throw std::out_of_range("ProcessPool: no task named " + name);
+  }
+
+  // Runs task `index` in a worker process and waits for it. A stop request
+  // kills the worker, which is then replaced like one that crashed.
+  Result run(std::size_t index, std::stop_token stop = {}) {
+    Worker worker;
+    if (!acquire(worker)) {
+      return {Outcome::Lost, {}};
+    }
+    Request request{static_cast<std::uint32_t>(index)};
+    Reply reply{};
+    bool answered;
+    {
+      std::stop_callback kill(stop,
+                              [pid = worker.pid]() { ::kill(pid, SIGKILL); });
+      answered = sendAll(worker.fd, &request, sizeof(request)) &&
+                 receive(worker.fd, &reply, sizeof(reply));
+    }
+    ++worker.runs;
+    // A stop that came after the reply may still have killed the worker.
+    bool retire = !answered || stop.stop_requested() ||
+                  (options.max_runs != 0 && worker.runs >= options.max_runs);
+    release(worker, retire);
+
+    Result result{answered ? (reply.failed ? Outcome::Failed : Outcome::Done)
+                           : Outcome::Lost,
+                  std::chrono::nanoseconds(reply.run_time)};
+    std::lock_guard<std::mutex> lock(mutex);
+    ++counts.runs;
+    counts.failed += result.outcome == Outcome::Failed;
+    counts.lost += result.outcome == Outcome::Lost;
+    return result;
+  }
+
+  // Job callable running `name` in the pool, for CronJobManager::addJob.
+  // The job's stop_token, signalled on timeout or removal, kills the run. A
+  // run that fails or loses its worker throws std::runtime_error, which the
+  // manager counts in JobStatus::failures.
+  auto task(const std::string &name) {
+    return [this, index = find(name)](std::stop_token stop) {
+      Result result = run(index, std::move(stop));
+      if (result.outcome == Outcome::Failed) {
+        throw std::runtime_error("ProcessPool: task " + tasks[index].first +
+                                 " failed");
+      }
+      if (result.outcome == Outcome::Lost) {
+        throw std::runtime_error("ProcessPool: task " + tasks[index].first +
+                                 " lost its worker");
+      }
+    };
+  }
+
+  Stats stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = counts;
+    result.processes = live;
+    return result;
+  }
+
+private:
+  struct Worker {
+    pid_t pid = -1;
+    int fd = -1;
+    std::size_t runs = 0;
+  };
+
+  struct Request {
+    std::uint32_t task;
+  };
+
+  struct Reply {
+    std::int64_t run_time;
+    std::uint8_t failed;
+  };
+
+  // Body of the fork server: forks a worker per byte received and sends its
+  // pid and socket back, until the pool closes the control socket.
+  // Workers are reaped automatically through SIGCHLD being ignored.
+  [[noreturn]] void serveForks(int socket) {
+    ::signal(SIGCHLD, SIG_IGN);
+    char byte;
+    while (receive(socket, &byte, 1)) {
+      int pair[2] = {-1, -1};
+      pid_t pid = -1;
+      if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) ==
+          0) {
+        pid = ::fork();
+        if (pid == 0) {
+          ::close(socket);
+          ::close(pair[0]);
+          ::signal(SIGCHLD, SIG_DFL);
+          serveRuns(pair[1]);
+        }
+        ::close(pair[1]);
+      }
+      bool sent = sendWorker(socket, pid, pid > 0 ? pair[0] : -1);
+      if (pair[0] >= 0) {
+        ::close(pair[0]);
+      }
+      if (!sent) {
+        break;
+      }
+    }
+    ::_exit(0);
+  }
+
+  // Body of a worker: runs one task per request until the pool closes its
+  // end of the socket.
+  [[noreturn]] void serveRuns(int socket) {
+    Request request;
+    while (receive(socket, &request, sizeof(request))) {
+      Reply reply{};
+      auto begin = std::chrono::steady_clock::now();
+      try {
+        tasks.at(request.task).second();
+      } catch (...) {
+        reply.failed = 1;
+      }
+      reply.run_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - begin)
+                           .count();
+      if (!sendAll(socket, &reply, sizeof(reply))) {
+        break;
+      }
+    }
+    ::_exit(0);
+  }
+
+  // Asks the fork server for a worker. Only the constructor and then the
+  // respawner thread use the control socket.
+  bool spawn(Worker &worker) {
+    char byte = 0;
+    if (!sendAll(control, &byte, 1)) {
+      return false;
+    }
+    pid_t pid = -1;
+    int fd = -1;
+    iovec iov{&pid, sizeof(pid)};
+    alignas(cmsghdr) char buffer[CMSG_SPACE(sizeof(int))];
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = buffer;
+    message.msg_controllen = sizeof(buffer);
+    ssize_t n;
+    while ((n = ::recvmsg(control, &message, MSG_CMSG_CLOEXEC)) < 0 &&
+           errno == EINTR) {
+    }
+    if (cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header != nullptr && header->cmsg_type == SCM_RIGHTS) {
+      std::memcpy(&fd, CMSG_DATA(header), sizeof(fd));
+    }
+    if (n != sizeof(pid) || pid <= 0 || fd < 0) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+      return false;
+    }
+    worker = {pid, fd, 0};
+    return true;
+  }
+
+  static bool sendWorker(int socket, pid_t pid, int fd) {
+    iovec iov{&pid, sizeof(pid)};
+    alignas(cmsghdr) char buffer[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    if (fd >= 0) {
+      message.msg_control = buffer;
+      message.msg_controllen = sizeof(buffer);
+      cmsghdr *header = CMSG_FIRSTHDR(&message);
+      header->cmsg_level = SOL_SOCKET;
+      header->cmsg_type = SCM_RIGHTS;
+      header->cmsg_len = CMSG_LEN(sizeof(int));
+      std::memcpy(CMSG_DATA(header), &fd, sizeof(fd));
+    }
+    ssize_t n;
+    while ((n = ::sendmsg(socket, &message, MSG_NOSIGNAL)) < 0 &&
+           errno == EINTR) {
+    }
+    return n == sizeof(pid);
+  }
+
+  // Sequenced packets arrive whole, so one call moves one message.
+  static bool sendAll(int fd, const void *data, std::size_t size) {
+    ssize_t n;
+    while ((n = ::send(fd, data, size, MSG_NOSIGNAL)) < 0 && errno == EINTR) {
+    }
+    return n == static_cast<ssize_t>(size);
+  }
+
+  static bool receive(int fd, void *data, std::size_t size) {
+    ssize_t n;
+    while ((n = ::recv(fd, data, size, 0)) < 0 && errno == EINTR) {
+    }
+    return n == static_cast<ssize_t>(size);
+  }
+
+  // Waits for an idle worker. False while none is left and the respawner
+  // has failed to start one.
+  bool acquire(Worker &worker) {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this]() { return !idle.empty() || broken; });
+    if (idle.empty()) {
+      return false;
+    }
+    worker = idle.back();
+    idle.pop_back();
+    return true;
+  }
+
+  // Returns a worker after a run. A retired one is closed, which makes it
+  // exit if it is still alive, and the respawner starts a replacement.
+  void release(const Worker &worker, bool retire) {
+    if (retire) {
+      ::close(worker.fd);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (retire) {
+        --live;
+        ++replace;
+      } else {
+        idle.push_back(worker);
+      }
+    }
+    if (retire) {
+      respawn_cv.notify_one();
+    } else {
+      idle_cv.notify_one();
+    }
+  }
+
+  // Starts a replacement for each retired worker. A spawn that fails is
+  // retried after a delay that doubles up to a second, until the pool is
+  // back at full size. While no worker at all is left, runs fail as Lost
+  // instead of waiting for one.
+  void respawn() {
+    constexpr std::chrono::milliseconds first_delay{10};
+    constexpr std::chrono::milliseconds max_delay{1000};
+    std::chrono::milliseconds delay{0};
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      respawn_cv.wait(lock, [this]() { return stopping || replace > 0; });
+      if (stopping) {
+        return;
+      }
+      lock.unlock();
+      Worker worker;
+      bool started = spawn(worker);
+      lock.lock();
+      if (started) {
+        --replace;
+        idle.push_back(worker);
+        ++live;
+        ++counts.respawned;
+        broken = false;
+        delay = std::chrono::milliseconds(0);
+        idle_cv.notify_all();
+        continue;
+      }
+      broken = live == 0;
+      idle_cv.notify_all();
+      delay = std::clamp(delay * 2, first_delay, max_delay);
+      respawn_cv.wait_for(lock, delay, [this]() { return stopping; });
+    }
+  }
+
+  void shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    respawn_cv.notify_all();
+    if (respawner.joinable()) {
+      respawner.join();
+    }
+    for (const Worker &worker : idle) {
+      ::close(worker.fd);
+    }
+    idle.clear();
+    if (control >= 0) {
+      ::close(control);
+      control = -1;
+    }
+    if (server > 0) {
+      while (::waitpid(server, nullptr, 0) < 0 && errno == EINTR) {
+      }
+      server = -1;
+    }
+  }
+
+  Tasks tasks;
+  Options options;
+  pid_t server = -1;
+  int control = -1;
+  mutable std::mutex mutex;
+  std::condition_variable idle_cv;
+  std::condition_variable respawn_cv;
+  std::vector<Worker> idle;
+  std::size_t live = 0;
+  std::size_t replace = 0;
+  bool broken = false;
+  bool stopping = false;
+  Stats counts{};
+  std::thread respawner;
+};
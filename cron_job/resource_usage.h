@@ -0,0 +1,26 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+// CPU time consumed by the calling thread. A system call, about as costly
+// as an uncontended futex.
+inline std::chrono::nanoseconds threadCpuTime() {
+  timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+// Bytes allocated by the calling thread so far, as reported through
+// countAllocation(). It stays zero unless an allocation hook reports to it:
+// linking in allocation_hook.cpp replaces the global operator new with one
+// that does.
+inline std::uint64_t &threadAllocated() {
+  static thread_local std::uint64_t bytes = 0;
+  return bytes;
+}
+
+inline void countAllocation(std::size_t bytes) noexcept {
+  threadAllocated() += bytes;
+}
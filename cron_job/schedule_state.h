@@ -0,0 +1,275 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+// What to do at startup about runs a job missed while the process was down.
+enum class CatchUp {
+  Skip, // resume at the next fire time of the original schedule
+  Once, // run once right away, then resume
+  All,  // replay every missed run back to back, then resume
+};
+
+// 64-bit FNV-1a. Unlike std::hash it is the same in every build, so it can
+// key data that outlives the process.
+inline std::uint64_t stableHash(std::string_view text) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : text) {
+    hash = (hash ^ c) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// Persisted schedule of one job, one cache line each. Times are
+// system_clock nanoseconds since the epoch. The scheduler updates them with
+// plain relaxed stores into the mapping; the kernel writes the pages back.
+struct ScheduleRecord {
+  static constexpr std::int64_t never = INT64_MAX;
+
+  std::atomic<std::uint64_t> key;
+  std::atomic<std::int64_t> last_run;
+  std::atomic<std::int64_t> next_due;
+  // Zero-terminated, truncated to fit; the key tells long names apart.
+  char name[40];
+};
+static_assert(sizeof(ScheduleRecord) == 64, "records are one cache line");
+
+// Memory-mapped, fixed-capacity hash table of ScheduleRecords keyed by job
+// name, using open addressing with linear probing. Opening it is one mmap
+// and each lookup touches a record or two, so restoring a job costs the
+// same with 100 or 100k jobs in the file and nothing is parsed up front.
+//
+// Removed jobs leave tombstones, which later claims reuse. The header keeps
+// the longest probe any live record needed, so looking up a name that is
+// not there stops after that many slots instead of running on to an empty
+// slot, which a table that has seen many removals may no longer have. Once
+// enough tombstones have built up, a sweep empties those no probe runs
+// through and recomputes the longest probe; records never move, so the
+// pointers claim() handed out stay valid.
+//
+// A file whose header does not match (new file, other format) is reset. The
+// capacity is fixed when the file is created; once it is full, new jobs
+// simply run without persisted state.
+class ScheduleState {
+public:
+  ScheduleState(const std::string &path, std::size_t capacity) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+
+    Header header{};
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      fail(path);
+    }
+    bool valid =
+        ::pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+        header.magic == MAGIC && header.capacity != 0 &&
+        (header.capacity & (header.capacity - 1)) == 0 &&
+        static_cast<std::size_t>(st.st_size) == fileSize(header.capacity);
+    if (!valid) {
+      header = {MAGIC, roundUp(capacity), 0, 0, 0, {}};
+      if (::ftruncate(fd, 0) != 0 ||
+          ::ftruncate(fd, fileSize(header.capacity)) != 0 ||
+          ::pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+        fail(path);
+      }
+    }
+
+    size = fileSize(header.capacity);
+    void *mapping =
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+      fail(path);
+    }
+    base = static_cast<char *>(mapping);
+    table = reinterpret_cast<Header *>(base);
+    records = reinterpret_cast<ScheduleRecord *>(base + sizeof(Header));
+    mask = header.capacity - 1;
+    swept = table->tombstones;
+  }
+
+  ScheduleState(const ScheduleState &) = delete;
+  ScheduleState &operator=(const ScheduleState &) = delete;
+
+  ~ScheduleState() {
+    ::munmap(base, size);
+    ::close(fd);
+  }
+
+  // Record for `name`, created empty if there is none; nullptr when the
+  // table is full. `found` reports whether it holds state from earlier.
+  ScheduleRecord *claim(std::string_view name, bool &found) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::uint64_t key = keyOf(name);
+    ScheduleRecord *reuse = nullptr;
+    std::size_t distance = 0;
+    // Every live record sits within `longest` slots of its home.
+    std::size_t limit = std::min<std::size_t>(table->longest, mask);
+    for (std::size_t i = 0; i <= limit; ++i) {
+      ScheduleRecord &record = records[(key + i) & mask];
+      std::uint64_t seen = record.key.load(std::memory_order_relaxed);
+      if (seen == EMPTY || seen == TOMBSTONE) {
+        if (reuse == nullptr) {
+          reuse = &record;
+          distance = i;
+        }
+        if (seen == EMPTY) {
+          break;
+        }
+      } else if (seen == key && sameName(record, name)) {
+        found = true;
+        return &record;
+      }
+    }
+
+    found = false;
+    if (table->live > mask) {
+      return nullptr;
+    }
+    for (std::size_t i = limit + 1; reuse == nullptr; ++i) {
+      ScheduleRecord &record = records[(key + i) & mask];
+      std::uint64_t seen = record.key.load(std::memory_order_relaxed);
+      if (seen == EMPTY || seen == TOMBSTONE) {
+        reuse = &record;
+        distance = i;
+      }
+    }
+    table->longest = std::max<std::uint64_t>(table->longest, distance);
+    ++table->live;
+    if (reuse->key.load(std::memory_order_relaxed) == TOMBSTONE) {
+      --table->tombstones;
+    }
+    reuse->last_run.store(0, std::memory_order_relaxed);
+    reuse->next_due.store(ScheduleRecord::never, std::memory_order_relaxed);
+    std::memset(reuse->name, 0, sizeof(reuse->name));
+    std::memcpy(reuse->name, name.data(),
+                std::min(name.size(), sizeof(reuse->name) - 1));
+    reuse->key.store(key, std::memory_order_relaxed);
+    return reuse;
+  }
+
+  // Drops the record of a removed job. No one may write it afterwards.
+  void forget(ScheduleRecord *record) {
+    std::lock_guard<std::mutex> lock(mutex);
+    record->key.store(TOMBSTONE, std::memory_order_relaxed);
+    --table->live;
+    ++table->tombstones;
+    if (table->tombstones > swept + capacity() / 8) {
+      sweep();
+    }
+  }
+
+  // Blocks until the mapping is on disk. Not needed to survive a crash of
+  // the process, only of the machine.
+  void flush() { ::msync(base, size, MS_SYNC); }
+
+  std::size_t capacity() const { return mask + 1; }
+
+private:
+  static constexpr std::uint64_t MAGIC = 0x32564a4e4f524331ull;
+  static constexpr std::uint64_t EMPTY = 0;
+  static constexpr std::uint64_t TOMBSTONE = 1;
+
+  // Lives at the start of the mapping; `longest` and `live` are updated in
+  // place under the mutex.
+  struct Header {
+    std::uint64_t magic;
+    std::uint64_t capacity;
+    // Longest distance from its home slot at which a record was claimed.
+    std::uint64_t longest;
+    // Records in use, and slots holding a tombstone.
+    std::uint64_t live;
+    std::uint64_t tombstones;
+    char padding[24];
+  };
+  static_assert(sizeof(Header) == 64, "keeps records cache-line aligned");
+
+  // Empties every tombstone that lies on no live record's probe path, from
+  // its home slot up to where it sits, and recomputes `longest`. Costs one
+  // pass over the table, taken once per capacity / 8 removals at most.
+  // Called with the mutex held.
+  void sweep() {
+    // Probe paths starting minus ending at each slot; the running sum is
+    // the number of paths through it.
+    std::vector<std::int64_t> paths(mask + 2, 0);
+    std::uint64_t longest = 0;
+    for (std::size_t i = 0; i <= mask; ++i) {
+      std::uint64_t key = records[i].key.load(std::memory_order_relaxed);
+      if (key == EMPTY || key == TOMBSTONE) {
+        continue;
+      }
+      std::size_t home = key & mask;
+      longest = std::max<std::uint64_t>(longest, (i - home) & mask);
+      ++paths[home];
+      --paths[i];
+      if (home > i) {
+        --paths[mask + 1];
+        ++paths[0];
+      }
+    }
+    std::int64_t through = 0;
+    for (std::size_t i = 0; i <= mask; ++i) {
+      through += paths[i];
+      if (through == 0 &&
+          records[i].key.load(std::memory_order_relaxed) == TOMBSTONE) {
+        records[i].key.store(EMPTY, std::memory_order_relaxed);
+        --table->tombstones;
+      }
+    }
+    table->longest = longest;
+    swept = table->tombstones;
+  }
+
+  static std::uint64_t keyOf(std::string_view name) {
+    std::uint64_t key = stableHash(name);
+    return key <= TOMBSTONE ? key + 2 : key;
+  }
+
+  static bool sameName(const ScheduleRecord &record, std::string_view name) {
+    std::size_t stored = ::strnlen(record.name, sizeof(record.name));
+    return name.substr(0, sizeof(record.name) - 1) ==
+           std::string_view(record.name, stored);
+  }
+
+  static std::size_t roundUp(std::size_t capacity) {
+    std::size_t result = 1;
+    while (result < capacity) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  static std::size_t fileSize(std::uint64_t capacity) {
+    return sizeof(Header) + capacity * sizeof(ScheduleRecord);
+  }
+
+  [[noreturn]] void fail(const std::string &path) {
+    int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), path);
+  }
+
+  int fd = -1;
+  char *base = nullptr;
+  std::size_t size = 0;
+  Header *table = nullptr;
+  ScheduleRecord *records = nullptr;
+  std::size_t mask = 0;
+  // Tombstones left by the last sweep, which could not empty them.
+  std::uint64_t swept = 0;
+  std::mutex mutex;
+};
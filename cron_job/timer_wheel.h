@@ -0,0 +1,203 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel over abstract integer ticks (100 us in the cron
+// manager).
+//
+// Each level has 64 slots; a timer lives on the highest level at which its
+// expiry tick differs from the current tick, in the slot given by that
+// level's 6 bits of the expiry. Level 0 slots therefore hold timers for one
+// exact tick, and a higher-level slot is cascaded down when the wheel enters
+// the block it covers. Insert, cancel and expire are O(1); empty stretches
+// are skipped using a per-level occupancy bitmap, so a long sleep costs one
+// step per non-empty slot rather than one per tick.
+template <typename T> class TimerWheel {
+public:
+  using TimerId = std::uint32_t;
+  static constexpr TimerId npos = UINT32_MAX;
+  static constexpr std::uint64_t never = UINT64_MAX;
+
+  explicit TimerWheel(std::uint64_t start_tick = 0) : current(start_tick) {
+    for (auto &level : slots) {
+      level.fill(npos);
+    }
+  }
+
+  std::uint64_t now() const { return current; }
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  // Arms a timer for `tick`; ticks in the past fire on the next advance().
+  TimerId insert(std::uint64_t tick, T value) {
+    TimerId id;
+    if (free_head != npos) {
+      id = free_head;
+      free_head = nodes[id].next;
+    } else {
+      id = static_cast<TimerId>(nodes.size());
+      nodes.emplace_back();
+    }
+    nodes[id].tick = tick < current ? current : tick;
+    nodes[id].value = std::move(value);
+    link(id);
+    ++count;
+    return id;
+  }
+
+  void cancel(TimerId id) {
+    unlink(id);
+    release(id);
+    --count;
+  }
+
+  // Tick at which the wheel next has work: either a timer expiring or a
+  // higher-level slot to cascade. Returns `never` when no timers are armed.
+  std::uint64_t nextTick() const {
+    for (int level = 0; level < LEVELS; ++level) {
+      int shift = level * BITS;
+      unsigned index = (current >> shift) & MASK;
+      std::uint64_t pending = occupied[level] >> index;
+      if (level > 0) {
+        pending &= ~std::uint64_t{1};
+      }
+      if (pending != 0) {
+        std::uint64_t block = current >> shift >> BITS << BITS;
+        return (block + index + __builtin_ctzll(pending)) << shift;
+      }
+    }
+    return never;
+  }
+
+  // Moves the wheel to `tick`, cascading higher levels on the way and
+  // calling `expire(value)` for every timer whose tick has been reached.
+  // `expire` may insert or cancel timers; new ones that are already due fire
+  // on the next call.
+  template <typename F> void advance(std::uint64_t tick, F &&expire) {
+    bool first = true;
+    for (std::uint64_t next = nextTick();
+         next <= tick && (first || next > current); next = nextTick()) {
+      first = false;
+      current = next;
+      for (int level = LEVELS - 1; level > 0; --level) {
+        cascade(level, (current >> (level * BITS)) & MASK);
+      }
+      expiring = detach(0, current & MASK);
+      for (TimerId id = expiring; id != npos; id = nodes[id].next) {
+        nodes[id].level = EXPIRING;
+      }
+      while (expiring != npos) {
+        TimerId id = expiring;
+        unlink(id);
+        --count;
+        T value = std::move(nodes[id].value);
+        release(id);
+        expire(value);
+      }
+    }
+    if (tick > current) {
+      current = tick;
+    }
+  }
+
+  // Removes every armed timer, passing each value to `visit`, which must not
+  // use the wheel.
+  template <typename F> void clear(F &&visit) {
+    for (int level = 0; level < LEVELS; ++level) {
+      for (unsigned slot = 0; slot <= MASK; ++slot) {
+        TimerId id = detach(level, slot);
+        while (id != npos) {
+          TimerId after = nodes[id].next;
+          --count;
+          T value = std::move(nodes[id].value);
+          release(id);
+          visit(value);
+          id = after;
+        }
+      }
+    }
+  }
+
+private:
+  static constexpr int BITS = 6;
+  static constexpr int LEVELS = 8;
+  static constexpr unsigned MASK = (1u << BITS) - 1;
+  // Level tag for timers detached from their slot and about to fire.
+  static constexpr std::uint16_t EXPIRING = LEVELS;
+
+  struct Node {
+    std::uint64_t tick = 0;
+    TimerId prev = npos;
+    TimerId next = npos;
+    std::uint16_t level = 0;
+    std::uint16_t slot = 0;
+    T value{};
+  };
+
+  void link(TimerId id) {
+    Node &node = nodes[id];
+    std::uint64_t diff = node.tick ^ current;
+    int level = diff == 0 ? 0 : (63 - __builtin_clzll(diff)) / BITS;
+    if (level >= LEVELS) {
+      level = LEVELS - 1;
+    }
+    node.level = static_cast<std::uint16_t>(level);
+    node.slot =
+        static_cast<std::uint16_t>((node.tick >> (level * BITS)) & MASK);
+    node.prev = npos;
+    node.next = slots[level][node.slot];
+    if (node.next != npos) {
+      nodes[node.next].prev = id;
+    }
+    slots[level][node.slot] = id;
+    occupied[level] |= std::uint64_t{1} << node.slot;
+  }
+
+  void unlink(TimerId id) {
+    Node &node = nodes[id];
+    TimerId &head =
+        node.level == EXPIRING ? expiring : slots[node.level][node.slot];
+    if (node.prev != npos) {
+      nodes[node.prev].next = node.next;
+    } else {
+      head = node.next;
+    }
+    if (node.next != npos) {
+      nodes[node.next].prev = node.prev;
+    }
+    if (node.level != EXPIRING && head == npos) {
+      occupied[node.level] &= ~(std::uint64_t{1} << node.slot);
+    }
+  }
+
+  TimerId detach(int level, unsigned slot) {
+    TimerId head = slots[level][slot];
+    slots[level][slot] = npos;
+    occupied[level] &= ~(std::uint64_t{1} << slot);
+    return head;
+  }
+
+  void cascade(int level, unsigned slot) {
+    TimerId id = detach(level, slot);
+    while (id != npos) {
+      TimerId after = nodes[id].next;
+      link(id);
+      id = after;
+    }
+  }
+
+  void release(TimerId id) {
+    nodes[id].value = T{};
+    nodes[id].next = free_head;
+    free_head = id;
+  }
+
+  std::uint64_t current;
+  std::size_t count = 0;
+  std::vector<Node> nodes;
+  TimerId free_head = npos;
+  TimerId expiring = npos;
+  std::array<std::array<TimerId, 64>, LEVELS> slots;
+  std::array<std::uint64_t, LEVELS> occupied{};
+};
@@ -0,0 +1,519 @@
+#include "broker.h"
+#include "mpmc_queue.h"
+#include "pipeline_ring.h"
+#include "spsc_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template <typename F> static double timeNs(F &&f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - begin)
+      .count();
+}
+
+// The queue main.cpp used before SpscRing: a std::queue behind a mutex, with
+// a condition variable signalled on every push. The bulk calls take the lock
+// and signal once per batch.
+template <typename T> class LockedQueue {
+public:
+  void push(T value) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.push(std::move(value));
+    }
+    cv.notify_one();
+  }
+
+  T pop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    wait(lock);
+    T value = std::move(queue.front());
+    queue.pop();
+    return value;
+  }
+
+  std::size_t push_bulk(std::span<const T> items) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const T &item : items) {
+        queue.push(item);
+      }
+    }
+    cv.notify_one();
+    return items.size();
+  }
+
+  // Blocks until the queue is not empty, then drains up to `max` elements.
+  std::size_t pop_bulk(T *out, std::size_t max) {
+    std::unique_lock<std::mutex> lock(mutex);
+    wait(lock);
+    std::size_t n = 0;
+    while (n < max && !queue.empty()) {
+      out[n++] = std::move(queue.front());
+      queue.pop();
+    }
+    return n;
+  }
+
+  // Times a consumer found the queue empty and went to sleep.
+  std::size_t sleeps = 0;
+
+private:
+  void wait(std::unique_lock<std::mutex> &lock) {
+    if (queue.empty()) {
+      ++sleeps;
+      cv.wait(lock, [this] { return !queue.empty(); });
+    }
+  }
+
+  std::queue<T> queue;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+template <typename T, std::size_t Capacity>
+static void push(SpscRing<T, Capacity> &ring, T value) {
+  while (!ring.try_push(value)) {
+    std::this_thread::yield();
+  }
+}
+
+template <typename T, std::size_t Capacity>
+static T pop(SpscRing<T, Capacity> &ring) {
+  T value;
+  while (!ring.try_pop(value)) {
+    std::this_thread::yield();
+  }
+  return value;
+}
+
+template <typename T, std::size_t Capacity>
+static void push(MpmcQueue<T, Capacity> &queue, T value) {
+  while (!queue.try_push(value)) {
+    std::this_thread::yield();
+  }
+}
+
+template <typename T, std::size_t Capacity>
+static T pop(MpmcQueue<T, Capacity> &queue) {
+  T value;
+  while (!queue.try_pop(value)) {
+    std::this_thread::yield();
+  }
+  return value;
+}
+
+template <typename T> static void push(LockedQueue<T> &queue, T value) {
+  queue.push(std::move(value));
+}
+
+template <typename T> static T pop(LockedQueue<T> &queue) {
+  return queue.pop();
+}
+
+// Pushes all of `items`, waiting for room as needed.
+template <typename Queue, typename T>
+static void pushAll(Queue &queue, std::span<const T> items) {
+  while (!items.empty()) {
+    auto n = queue.push_bulk(items);
+    if (n == 0) {
+      std::this_thread::yield();
+    }
+    items = items.subspan(n);
+  }
+}
+
+// Pops between 1 and `max` items, waiting for one as needed.
+template <typename Queue, typename T>
+static std::size_t popSome(Queue &queue, T *out, std::size_t max) {
+  std::size_t n;
+  while ((n = queue.pop_bulk(out, max)) == 0) {
+    std::this_thread::yield();
+  }
+  return n;
+}
+
+// Per-item cost of streaming between two threads when each side moves up to
+// `batch` items per synchronization point: a lock acquisition and signal for
+// LockedQueue, an index publish for the rings. The producer pushes in
+// batches; the consumer takes whatever is there, up to a batch.
+template <typename Queue> static void benchBatching(const char *name) {
+  constexpr long items = 1 << 22;
+  std::printf("  %s\n", name);
+  for (std::size_t batch : {1, 4, 16, 64, 256}) {
+    Queue queue;
+    long sum = 0;
+    long pops = 0;
+    double ns = timeNs([&]() {
+      std::thread consumer([&]() {
+        std::vector<long> out(batch);
+        for (long got = 0; got < items; ++pops) {
+          auto n = popSome(queue, out.data(), batch);
+          for (std::size_t i = 0; i < n; ++i) {
+            sum += out[i];
+          }
+          got += n;
+        }
+      });
+      std::vector<long> in(batch);
+      for (long i = 0; i < items; i += batch) {
+        for (std::size_t j = 0; j < batch; ++j) {
+          in[j] = i + j;
+        }
+        pushAll(queue, std::span<const long>(in));
+      }
+      consumer.join();
+    });
+    if (sum != items * (items - 1) / 2) {
+      std::printf("    lost items\n");
+    }
+    std::printf("    batch %3zu %8.1f ns per item %8.1f items per pop",
+                batch, ns / items, static_cast<double>(items) / pops);
+    if constexpr (requires { queue.sleeps; }) {
+      std::printf(" %6.3f sleeps per item",
+                  static_cast<double>(queue.sleeps) / items);
+    }
+    std::printf("\n");
+  }
+}
+
+// Items per second streamed from one producer thread to one consumer.
+template <typename Queue> static void benchThroughput(const char *name) {
+  constexpr long items = 10000000;
+  Queue queue;
+  long sum = 0;
+  double ns = timeNs([&]() {
+    std::thread consumer([&]() {
+      for (long i = 0; i < items; ++i) {
+        sum += pop(queue);
+      }
+    });
+    for (long i = 0; i < items; ++i) {
+      push(queue, i);
+    }
+    consumer.join();
+  });
+  if (sum != items * (items - 1) / 2) {
+    std::printf("  %s lost items\n", name);
+  }
+  std::printf("  %-12s %8.1f M items/s\n", name, items / ns * 1e3);
+}
+
+// One item bounced between two threads through a pair of queues; a round
+// trip is two hand-offs.
+template <typename Queue> static void benchRoundTrip(const char *name) {
+  constexpr long trips = 200000;
+  Queue ping;
+  Queue pong;
+  double ns = timeNs([&]() {
+    std::thread echo([&]() {
+      for (long i = 0; i < trips; ++i) {
+        push(pong, pop(ping));
+      }
+    });
+    for (long i = 0; i < trips; ++i) {
+      push(ping, i);
+      pop(pong);
+    }
+    echo.join();
+  });
+  std::printf("  %-12s %8.0f ns per round trip\n", name, ns / trips);
+}
+
+// Items per second through one queue shared by `threads` producers and as
+// many consumers.
+template <typename Queue> static void benchScaling(const char *name) {
+  constexpr long items = 1 << 21;
+  std::printf("  %s\n", name);
+  for (int threads : {1, 2, 4, 8, 16, 32}) {
+    Queue queue;
+    std::atomic<long> sum{0};
+    long per_thread = items / threads;
+    double ns = timeNs([&]() {
+      std::vector<std::thread> workers;
+      for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+          long local = 0;
+          for (long i = 0; i < per_thread; ++i) {
+            local += pop(queue);
+          }
+          sum += local;
+        });
+        workers.emplace_back([&, t]() {
+          for (long i = 0; i < per_thread; ++i) {
+            push(queue, t * per_thread + i);
+          }
+        });
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+    });
+    if (sum != items * (items - 1) / 2) {
+      std::printf("    lost items\n");
+    }
+    std::printf("    %2d x %-2d threads %8.1f M items/s\n", threads, threads,
+                items / ns * 1e3);
+  }
+}
+
+// A broker as often first written: subscribers kept with their topic name,
+// matched by string comparison on every publish, and each handed its own copy
+// of the message.
+class CopyingBroker {
+public:
+  using Handler = std::function<void(const std::string &)>;
+
+  void subscribe(std::string topic, Handler handler) {
+    subscribers.emplace_back(std::move(topic), std::move(handler));
+  }
+
+  void publish(const std::string &topic, const std::string &payload) {
+    for (auto &[name, handler] : subscribers) {
+      if (name == topic) {
+        std::string copy = payload;
+        handler(copy);
+      }
+    }
+  }
+
+private:
+  std::vector<std::pair<std::string, Handler>> subscribers;
+};
+
+// Cost of publishing a 1 KB message to 50 subscribers of one of 10 topics.
+static void benchFanout() {
+  constexpr int topics = 10;
+  constexpr int subscribers = 50;
+  constexpr int messages = 100000;
+  std::string body(1024, 'x');
+  std::vector<std::string> names;
+  for (int t = 0; t < topics; ++t) {
+    names.push_back("market.prices.venue" + std::to_string(t));
+  }
+  long seen = 0;
+
+  CopyingBroker copying;
+  for (int t = 0; t < topics; ++t) {
+    for (int s = 0; s < subscribers; ++s) {
+      copying.subscribe(names[t],
+                        [&seen](const std::string &p) { seen += p.size(); });
+    }
+  }
+  double ns = timeNs([&]() {
+    for (int i = 0; i < messages; ++i) {
+      copying.publish(names[i % topics], body);
+    }
+  });
+  std::printf("  copies, string topics   %8.0f ns per publish\n",
+              ns / messages);
+
+  Broker broker;
+  std::vector<TopicId> ids;
+  for (int t = 0; t < topics; ++t) {
+    ids.push_back(broker.topic(names[t]));
+    for (int s = 0; s < subscribers; ++s) {
+      broker.subscribe(ids[t], [&seen](const Message &m) {
+        seen += m.payload.size();
+      });
+    }
+  }
+  ns = timeNs([&]() {
+    for (int i = 0; i < messages; ++i) {
+      broker.publish(names[i % topics], Payload(body));
+    }
+  });
+  std::printf("  shared, topic by name   %8.0f ns per publish\n",
+              ns / messages);
+  ns = timeNs([&]() {
+    for (int i = 0; i < messages; ++i) {
+      broker.publish(ids[i % topics], Payload(body));
+    }
+  });
+  std::printf("  shared, interned topic  %8.0f ns per publish\n",
+              ns / messages);
+  if (seen != 3L * messages * subscribers * 1024) {
+    std::printf("  lost messages\n");
+  }
+}
+
+// What flows through the 4-stage pipelines: the producer sets the id and
+// timestamp, enrich adds a price, serialize renders the text, and the sink
+// checks it and records the end-to-end latency.
+struct Event {
+  long id = 0;
+  std::chrono::steady_clock::time_point created;
+  double price = 0;
+  char text[48] = {};
+  std::size_t length = 0;
+};
+
+static void produce(Event &event, long id) {
+  event.id = id;
+  event.created = std::chrono::steady_clock::now();
+}
+
+static void enrich(Event &event) { event.price = event.id * 0.25 + 100; }
+
+static void serialize(Event &event) {
+  auto end = std::to_chars(event.text, event.text + sizeof(event.text),
+                           event.price)
+                 .ptr;
+  event.length = end - event.text;
+}
+
+static std::chrono::nanoseconds sink(const Event &event, long &bytes) {
+  bytes += event.length;
+  return std::chrono::steady_clock::now() - event.created;
+}
+
+struct PipelineResult {
+  double ns;
+  std::vector<std::chrono::nanoseconds> latencies;
+};
+
+// Runs `events` through producer -> enrich -> serialize -> sink on one
+// PipelineRing, each stage on its own thread. Paced runs wait for the sink
+// before producing the next event, to measure latency without queueing.
+static PipelineResult runRing(long events, bool paced) {
+  auto ring = std::make_unique<PipelineRing<Event, 1024, 4>>();
+  PipelineResult result;
+  result.latencies.reserve(events);
+  long bytes = 0;
+  result.ns = timeNs([&]() {
+    auto stage = [&](std::size_t index, auto &&work) {
+      return std::thread([&, index, work]() {
+        for (long done = 0; done < events;) {
+          auto begin = ring->position(index);
+          auto n = ring->wait(index);
+          for (auto s = begin; s != begin + n; ++s) {
+            work((*ring)[s]);
+          }
+          ring->commit(index, n);
+          done += n;
+        }
+      });
+    };
+    std::thread enricher = stage(1, enrich);
+    std::thread serializer = stage(2, serialize);
+    std::thread sinker = stage(3, [&](const Event &event) {
+      result.latencies.push_back(sink(event, bytes));
+    });
+    for (long id = 0; id < events;) {
+      auto begin = ring->position(0);
+      auto n = paced ? 1 : std::min<long>(ring->wait(0), events - id);
+      if (paced) {
+        // The whole ring is free once the sink has finished every event.
+        while (ring->available(0) != ring->capacity()) {
+          std::this_thread::yield();
+        }
+      }
+      for (auto s = begin; s != begin + n; ++s) {
+        produce((*ring)[s], id++);
+      }
+      ring->commit(0, n);
+    }
+    enricher.join();
+    serializer.join();
+    sinker.join();
+  });
+  return result;
+}
+
+// The same pipeline with a mutex-guarded queue per hop, copying each event
+// from one stage's queue into the next.
+static PipelineResult runQueues(long events, bool paced) {
+  LockedQueue<Event> hops[3];
+  std::atomic<long> sunk{0};
+  PipelineResult result;
+  result.latencies.reserve(events);
+  long bytes = 0;
+  result.ns = timeNs([&]() {
+    auto stage = [&](int index, auto &&work) {
+      return std::thread([&, index, work]() {
+        for (long done = 0; done < events; ++done) {
+          Event event = hops[index - 1].pop();
+          work(event);
+          if (index < 3) {
+            hops[index].push(event);
+          }
+        }
+      });
+    };
+    std::thread enricher = stage(1, enrich);
+    std::thread serializer = stage(2, serialize);
+    std::thread sinker = stage(3, [&](Event &event) {
+      result.latencies.push_back(sink(event, bytes));
+      sunk.store(sunk.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+    });
+    for (long id = 0; id < events; ++id) {
+      if (paced) {
+        while (sunk.load(std::memory_order_acquire) != id) {
+          std::this_thread::yield();
+        }
+      }
+      Event event;
+      produce(event, id);
+      hops[0].push(event);
+    }
+    enricher.join();
+    serializer.join();
+    sinker.join();
+  });
+  return result;
+}
+
+// Throughput and end-to-end latency of a 4-stage pipeline, flat out and
+// paced one event at a time.
+template <typename Run> static void benchPipeline(const char *name, Run run) {
+  constexpr long events = 1 << 21;
+  constexpr long paced_events = 20000;
+  auto flat = run(events, false);
+  auto paced = run(paced_events, true);
+  auto &latencies = paced.latencies;
+  std::sort(latencies.begin(), latencies.end());
+  std::printf("  %-18s %6.1f M events/s  latency p50 %6lld ns  p99 %7lld "
+              "ns\n",
+              name, events / flat.ns * 1e3,
+              static_cast<long long>(latencies[latencies.size() / 2].count()),
+              static_cast<long long>(
+                  latencies[latencies.size() * 99 / 100].count()));
+}
+
+int main() {
+  std::printf("SPSC throughput\n");
+  benchThroughput<SpscRing<long, 1024>>("SpscRing");
+  benchThroughput<LockedQueue<long>>("LockedQueue");
+  std::printf("SPSC round trip\n");
+  benchRoundTrip<SpscRing<long, 1024>>("SpscRing");
+  benchRoundTrip<LockedQueue<long>>("LockedQueue");
+  std::printf("MPMC throughput, producers x consumers\n");
+  benchScaling<MpmcQueue<long, 1024>>("MpmcQueue");
+  benchScaling<LockedQueue<long>>("LockedQueue");
+  std::printf("Bulk push and pop, one producer and one consumer\n");
+  benchBatching<SpscRing<long, 1024>>("SpscRing");
+  benchBatching<MpmcQueue<long, 1024>>("MpmcQueue");
+  benchBatching<LockedQueue<long>>("LockedQueue");
+  std::printf("Fan-out to 50 subscribers\n");
+  benchFanout();
+  std::printf("Pipeline, producer -> enrich -> serialize -> sink\n");
+  benchPipeline("PipelineRing", runRing);
+  benchPipeline("queue per hop", runQueues);
+  return 0;
+}
@@ -0,0 +1,192 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Immutable message body shared by reference count. Copying a Payload copies
+// a pointer, so a message fanned out to many subscribers is stored once and
+// freed when the last of them drops it.
+class Payload {
+public:
+  Payload() = default;
+
+  // Copies `source` into a new buffer, allocated in one block with its
+  // reference count.
+  explicit Payload(std::string_view source) : length(source.size()) {
+    auto buffer = std::make_shared_for_overwrite<char[]>(length);
+    // An empty view may have a null data(), which memcpy must not be given.
+    if (!source.empty()) {
+      std::memcpy(buffer.get(), source.data(), length);
+    }
+    bytes = std::move(buffer);
+  }
+
+  const char *data() const { return bytes.get(); }
+  std::size_t size() const { return length; }
+  std::string_view view() const { return {bytes.get(), length}; }
+  // Holders of this buffer, including this one.
+  long use_count() const { return bytes.use_count(); }
+
+private:
+  std::shared_ptr<const char[]> bytes;
+  std::size_t length = 0;
+};
+
+// Small integer standing for a topic name; see Broker::topic().
+using TopicId = std::uint32_t;
+
+struct Message {
+  TopicId topic = 0;
+  Payload payload;
+};
+
+// In-process publish/subscribe. Topic names are interned once into dense
+// TopicIds, and each id indexes straight into its list of subscribers, so
+// publishing does no string hashing or comparison when given an id.
+// Publishers look their topics up once:
+//
+//   TopicId prices = broker.topic("prices");
+//   broker.subscribe(prices, [](const Message &m) { show(m.payload.view()); });
+//   broker.publish(prices, Payload(quote));
+//
+// Handlers run on the publishing thread, under a shared lock on the topic
+// table, so publishers do not block one another, but a handler must not
+// subscribe or unsubscribe. A subscriber that should not slow publishers down
+// subscribes a queue instead and drains it on its own thread.
+class Broker {
+public:
+  using Handler = std::function<void(const Message &)>;
+  using SubscriptionId = std::uint64_t;
+
+  // Id of topic `name`, interning it on first use. Ids are never reused.
+  TopicId topic(std::string_view name) {
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      auto it = ids.find(name);
+      if (it != ids.end()) {
+        return it->second;
+      }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto [it, inserted] =
+        ids.try_emplace(std::string(name), static_cast<TopicId>(names.size()));
+    if (inserted) {
+      names.emplace_back(name);
+      topics.emplace_back();
+    }
+    return it->second;
+  }
+
+  std::string topicName(TopicId id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return id < names.size() ? names[id] : std::string();
+  }
+
+  SubscriptionId subscribe(TopicId id, Handler handler) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (id >= topics.size()) {
+      return 0;
+    }
+    auto subscription = ++last_subscription;
+    topics[id].push_back({subscription, std::move(handler)});
+    return subscription;
+  }
+
+  SubscriptionId subscribe(std::string_view name, Handler handler) {
+    return subscribe(topic(name), std::move(handler));
+  }
+
+  // Delivers into `queue`, which must outlive the subscription and accept
+  // try_push() from every publishing thread: an MpmcQueue, or an SpscRing if
+  // there is a single publisher. Messages that find the queue full are
+  // dropped and counted in dropped().
+  template <typename Queue>
+    requires requires(Queue &queue, const Message &message) {
+      queue.try_push(message);
+    }
+  SubscriptionId subscribe(TopicId id, Queue &queue) {
+    return subscribe(id, [this, &queue](const Message &message) {
+      if (!queue.try_push(message)) {
+        dropped_messages.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+
+  template <typename Queue>
+    requires requires(Queue &queue, const Message &message) {
+      queue.try_push(message);
+    }
+  SubscriptionId subscribe(std::string_view name, Queue &queue) {
+    return subscribe(topic(name), queue);
+  }
+
+  // Once this returns, the subscription's handler is not running and will
+  // not run again.
+  bool unsubscribe(SubscriptionId subscription) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (auto &subscribers : topics) {
+      for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+        if (it->id == subscription) {
+          subscribers.erase(it);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Hands `payload` to every subscriber of topic `id`; all of them share the
+  // one buffer. Returns the number of subscribers reached.
+  std::size_t publish(TopicId id, Payload payload) {
+    Message message{id, std::move(payload)};
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (id >= topics.size()) {
+      return 0;
+    }
+    for (auto &subscriber : topics[id]) {
+      subscriber.handler(message);
+    }
+    return topics[id].size();
+  }
+
+  // Convenience for one-off publishers; interns `name` on every call.
+  std::size_t publish(std::string_view name, Payload payload) {
+    return publish(topic(name), std::move(payload));
+  }
+
+  // Messages a full subscriber queue could not take.
+  std::uint64_t dropped() const {
+    return dropped_messages.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Subscriber {
+    SubscriptionId id;
+    Handler handler;
+  };
+
+  // Lets `ids` be searched with a string_view without building a string.
+  struct NameHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>()(name);
+    }
+  };
+
+  mutable std::shared_mutex mutex;
+  std::unordered_map<std::string, TopicId, NameHash, std::equal_to<>> ids;
+  std::vector<std::string> names;
+  std::vector<std::vector<Subscriber>> topics;
+  SubscriptionId last_subscription = 0;
+  std::atomic<std::uint64_t> dropped_messages{0};
+};
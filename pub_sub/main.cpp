@@ -1,15 +1,18 @@
+#include "broker.h"
+#include "spsc_ring.h"
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
+#include <cstddef>
 #include <iostream>
-#include <mutex>
 #include <ostream>
-#include <queue>
 #include <random>
+#include <string>
 #include <thread>
-std::queue<int> data_queue;
-std::mutex queue_mutex;
-std::condition_variable cv;
-bool finished{false};
+Broker broker;
+const TopicId numbers = broker.topic("numbers");
+// The producer is the only publisher, so a single-producer ring will do.
+SpscRing<Message, 64> data_queue;
+std::atomic<bool> finished{false};
 
 void producer(int items) {
   std::random_device rd;
@@ -18,40 +21,49 @@ void producer(int items) {
 
   for (int i = 0; i < items; ++i) {
     int value = dis(gen);
-    {
-      std::lock_guard<std::mutex> lock(queue_mutex);
-      data_queue.push(value);
-      std::cout << "Produced " << value << std::endl;
-    }
-    cv.notify_one();
+    broker.publish(numbers, Payload(std::to_string(value)));
+    std::cout << "Produced " << value << std::endl;
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
-  {
-    std::lock_guard<std::mutex> lock(queue_mutex);
-    finished = true;
-  }
-  cv.notify_one();
+  finished.store(true, std::memory_order_release);
 }
 void consumer() {
+  Message messages[data_queue.capacity()];
   while (true) {
-    std::unique_lock<std::mutex> lock(queue_mutex);
-    cv.wait(lock, [] { return !data_queue.empty() || finished; });
-    if (finished && data_queue.empty()) {
-      std::cout << "Consumer finished" << std::endl;
-      return;
+    // Takes everything produced since the last look in one go.
+    std::size_t count = data_queue.pop_bulk(messages, data_queue.capacity());
+    if (count == 0 && finished.load(std::memory_order_acquire)) {
+      // Everything pushed before `finished` was set is visible once it is
+      // seen, so one more look settles whether the queue is drained.
+      count = data_queue.pop_bulk(messages, data_queue.capacity());
+      if (count == 0) {
+        std::cout << "Consumer finished" << std::endl;
+        return;
+      }
+    }
+    if (count == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      std::cout << "Consumed: " << messages[i].payload.view() << std::endl;
     }
-    int value = data_queue.front();
-    data_queue.pop();
-    std::cout << "Consumed: " << value << std::endl;
-    lock.unlock();
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
 }
 int main(int argc, char *argv[]) {
+  // A second subscriber sees the same payloads, run on the producer thread.
+  std::atomic<int> total{0};
+  broker.subscribe(numbers, [&total](const Message &message) {
+    total += std::stoi(std::string(message.payload.view()));
+  });
+  broker.subscribe(numbers, data_queue);
+
   std::thread producer_thread(producer, 10);
   std::thread consumer_thread(consumer);
 
   producer_thread.join();
   consumer_thread.join();
+  std::cout << "Total: " << total << std::endl;
   return 0;
 }
@@ -0,0 +1,190 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <utility>
+
+// Fixed-size lock-free queue for any number of producer and consumer
+// threads. Capacity must be a power of two.
+//
+// Every slot carries a sequence number that says whose turn it is: a slot at
+// position `pos` is free for the producer that claims `pos` when its
+// sequence equals `pos`, and holds an element for the consumer that claims
+// `pos` when it equals `pos + 1`. Producers claim positions by advancing
+// `tail` with a compare-and-swap, consumers by advancing `head`; the slot's
+// sequence, stored with release and loaded with acquire, then hands the
+// element over. There is no global lock, and producers and consumers only
+// contend among themselves, on different cache lines. A thread that claims
+// a slot its peer has not finished with sees the wrong sequence and reports
+// the queue full (or empty) instead of waiting.
+template <typename T, std::size_t Capacity> class MpmcQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "MpmcQueue capacity must be a power of two");
+
+public:
+  MpmcQueue() {
+    for (std::size_t i = 0; i < Capacity; ++i) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  MpmcQueue(const MpmcQueue &) = delete;
+  MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+  ~MpmcQueue() {
+    auto end = tail.load(std::memory_order_relaxed);
+    for (auto i = head.load(std::memory_order_relaxed); i != end; ++i) {
+      slots[i & MASK].item()->~T();
+    }
+  }
+
+  // Returns false, leaving `value` untouched, if the queue is full.
+  bool try_push(const T &value) { return try_emplace(value); }
+  bool try_push(T &&value) { return try_emplace(std::move(value)); }
+
+  template <typename... Args> bool try_emplace(Args &&...args) {
+    auto pos = tail.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &slots[pos & MASK];
+      auto seq = slot->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (static_cast<void *>(slot->storage)) T(std::forward<Args>(args)...);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves the oldest element into `out`; returns false if the queue is
+  // empty.
+  bool try_pop(T &out) {
+    auto pos = head.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &slots[pos & MASK];
+      auto seq = slot->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+    T *item = slot->item();
+    out = std::move(*item);
+    item->~T();
+    slot->sequence.store(pos + Capacity, std::memory_order_release);
+    return true;
+  }
+
+  // Pushes as many leading elements of `items` as there are free slots in a
+  // row, claiming them all with one compare-and-swap; returns how many were
+  // pushed. A slot that is free for position `pos` stays free until `pos` is
+  // claimed, so checking the run first and then claiming it is safe.
+  std::size_t push_bulk(std::span<const T> items) {
+    if (items.empty()) {
+      return 0;
+    }
+    auto pos = tail.load(std::memory_order_relaxed);
+    std::size_t n;
+    while (true) {
+      n = 0;
+      while (n < items.size() && n < Capacity &&
+             slots[(pos + n) & MASK].sequence.load(
+                 std::memory_order_acquire) == pos + n) {
+        ++n;
+      }
+      if (n == 0) {
+        auto seq = slots[pos & MASK].sequence.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq - pos) < 0) {
+          return 0;
+        }
+        pos = tail.load(std::memory_order_relaxed);
+      } else if (tail.compare_exchange_weak(pos, pos + n,
+                                            std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      Slot &slot = slots[(pos + i) & MASK];
+      ::new (static_cast<void *>(slot.storage)) T(items[i]);
+      slot.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return n;
+  }
+
+  // Moves up to `max` of the oldest elements to `out`, claiming the run of
+  // filled slots with one compare-and-swap; returns how many were popped.
+  std::size_t pop_bulk(T *out, std::size_t max) {
+    if (max == 0) {
+      return 0;
+    }
+    auto pos = head.load(std::memory_order_relaxed);
+    std::size_t n;
+    while (true) {
+      n = 0;
+      while (n < max && n < Capacity &&
+             slots[(pos + n) & MASK].sequence.load(
+                 std::memory_order_acquire) == pos + n + 1) {
+        ++n;
+      }
+      if (n == 0) {
+        auto seq = slots[pos & MASK].sequence.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq - (pos + 1)) < 0) {
+          return 0;
+        }
+        pos = head.load(std::memory_order_relaxed);
+      } else if (head.compare_exchange_weak(pos, pos + n,
+                                            std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      Slot &slot = slots[(pos + i) & MASK];
+      T *item = slot.item();
+      out[i] = std::move(*item);
+      item->~T();
+      slot.sequence.store(pos + i + Capacity, std::memory_order_release);
+    }
+    return n;
+  }
+
+  // A snapshot, and only approximate while other threads are active.
+  std::size_t size() const {
+    auto h = head.load(std::memory_order_acquire);
+    auto t = tail.load(std::memory_order_acquire);
+    return t > h ? t - h : 0;
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+  static constexpr std::size_t MASK = Capacity - 1;
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T *item() { return std::launder(reinterpret_cast<T *>(storage)); }
+  };
+
+  alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};
+  alignas(CACHE_LINE) std::atomic<std::size_t> head{0};
+  alignas(CACHE_LINE) Slot slots[Capacity];
+};
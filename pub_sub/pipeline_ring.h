@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// Preallocated ring shared by a fixed chain of stages, each run by one
+// thread, in the style of the LMAX Disruptor. Entries are never copied or
+// moved between stages: the first stage fills an entry in place, and every
+// later stage reads and updates that same entry after the stage before it is
+// done with it.
+//
+// Each stage owns a cursor, the count of entries it has finished. Stage k may
+// work on entries below the cursor of stage k - 1, its barrier; stage 0, the
+// producer, may reuse a slot once the last stage has finished with it. A
+// cursor is published with a release store and read with an acquire load, so
+// an entry's contents travel with it, and no lock is taken anywhere. A stage
+// takes every entry available behind its barrier at once and publishes its
+// cursor once per batch.
+//
+//   PipelineRing<Event, 1024, 3> ring;
+//   // stage 1, on its own thread:
+//   while (running) {
+//     auto begin = ring.position(1);
+//     auto n = ring.wait(1);
+//     for (auto s = begin; s != begin + n; ++s) {
+//       enrich(ring[s]);
+//     }
+//     ring.commit(1, n);
+//   }
+//
+// Entries are default-constructed once and reused; a stage overwrites what
+// it needs. The ring has no notion of shutdown: stages agree on a count or on
+// a sentinel entry.
+template <typename T, std::size_t Capacity, std::size_t Stages>
+class PipelineRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "PipelineRing capacity must be a power of two");
+  static_assert(Stages >= 2, "PipelineRing needs a producer and a consumer");
+
+public:
+  PipelineRing() = default;
+  PipelineRing(const PipelineRing &) = delete;
+  PipelineRing &operator=(const PipelineRing &) = delete;
+
+  // Sequence of the next entry `stage` will work on.
+  std::uint64_t position(std::size_t stage) const {
+    return cursors[stage].next.load(std::memory_order_relaxed);
+  }
+
+  // Entries `stage` may work on now, starting at position(stage): free slots
+  // for the first stage, entries the previous stage has finished otherwise.
+  // Only the thread running `stage` may call this.
+  std::size_t available(std::size_t stage) const {
+    auto next = cursors[stage].next.load(std::memory_order_relaxed);
+    if (stage == 0) {
+      return cursors[Stages - 1].next.load(std::memory_order_acquire) +
+             Capacity - next;
+    }
+    return cursors[stage - 1].next.load(std::memory_order_acquire) - next;
+  }
+
+  // Like available(), but yields until at least one entry is ready.
+  std::size_t wait(std::size_t stage) const {
+    std::size_t n;
+    while ((n = available(stage)) == 0) {
+      std::this_thread::yield();
+    }
+    return n;
+  }
+
+  T &operator[](std::uint64_t sequence) { return entries[sequence & MASK]; }
+
+  // Hands the next `n` entries of `stage` on to the stage after it.
+  void commit(std::size_t stage, std::size_t n) {
+    Cursor &own = cursors[stage];
+    own.next.store(own.next.load(std::memory_order_relaxed) + n,
+                   std::memory_order_release);
+  }
+
+  static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+  static constexpr std::size_t MASK = Capacity - 1;
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  struct alignas(CACHE_LINE) Cursor {
+    std::atomic<std::uint64_t> next{0};
+  };
+
+  T entries[Capacity] = {};
+  Cursor cursors[Stages];
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <utility>
+
+// Fixed-size lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity must be a power of two so that a slot index is a mask of
+// a free-running counter instead of a division.
+//
+// The producer owns `tail` and the consumer owns `head`; each publishes its
+// index with a release store and reads the other's with an acquire load, so
+// an element is fully constructed before the consumer can see it and fully
+// destroyed before the producer can reuse its slot. Each side also keeps a
+// cached copy of the other's index and only reloads it when the ring looks
+// full (or empty), so in steady state neither side touches the other's
+// cache line. The two indices sit on separate cache lines to avoid false
+// sharing.
+template <typename T, std::size_t Capacity> class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+public:
+  SpscRing() = default;
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  ~SpscRing() {
+    auto end = tail.load(std::memory_order_relaxed);
+    for (auto i = head.load(std::memory_order_relaxed); i != end; ++i) {
+      slot(i)->~T();
+    }
+  }
+
+  // Producer only. Returns false, leaving `value` untouched, if the ring is
+  // full.
+  bool try_push(const T &value) { return try_emplace(value); }
+  bool try_push(T &&value) { return try_emplace(std::move(value)); }
+
+  template <typename... Args> bool try_emplace(Args &&...args) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - head_cache == Capacity) {
+      head_cache = head.load(std::memory_order_acquire);
+      if (t - head_cache == Capacity) {
+        return false;
+      }
+    }
+    ::new (static_cast<void *>(slot(t))) T(std::forward<Args>(args)...);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Moves the oldest element into `out`; returns false if the
+  // ring is empty.
+  bool try_pop(T &out) {
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == tail_cache) {
+      tail_cache = tail.load(std::memory_order_acquire);
+      if (h == tail_cache) {
+        return false;
+      }
+    }
+    T *item = slot(h);
+    out = std::move(*item);
+    item->~T();
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer only. Copies as many leading elements of `items` as fit and
+  // publishes them with a single store; returns how many were pushed.
+  std::size_t push_bulk(std::span<const T> items) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (Capacity - (t - head_cache) < items.size()) {
+      head_cache = head.load(std::memory_order_acquire);
+    }
+    auto n = std::min(Capacity - (t - head_cache), items.size());
+    for (std::size_t i = 0; i < n; ++i) {
+      ::new (static_cast<void *>(slot(t + i))) T(items[i]);
+    }
+    tail.store(t + n, std::memory_order_release);
+    return n;
+  }
+
+  // Consumer only. Moves up to `max` of the oldest elements to `out` and
+  // releases their slots with a single store; returns how many were popped.
+  // With a large `max` this drains everything the producer has published.
+  std::size_t pop_bulk(T *out, std::size_t max) {
+    auto h = head.load(std::memory_order_relaxed);
+    if (tail_cache - h < max) {
+      tail_cache = tail.load(std::memory_order_acquire);
+    }
+    auto n = std::min(tail_cache - h, max);
+    for (std::size_t i = 0; i < n; ++i) {
+      T *item = slot(h + i);
+      out[i] = std::move(*item);
+      item->~T();
+    }
+    head.store(h + n, std::memory_order_release);
+    return n;
+  }
+
+  // A snapshot; exact only when called from a side whose peer is idle.
+  std::size_t size() const {
+    return tail.load(std::memory_order_acquire) -
+           head.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+  static constexpr std::size_t MASK = Capacity - 1;
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  T *slot(std::size_t i) {
+    return std::launder(
+        reinterpret_cast<T *>(storage + (i & MASK) * sizeof(T)));
+  }
+
+  // Written by the producer.
+  alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};
+  std::size_t head_cache = 0;
+  // Written by the consumer.
+  alignas(CACHE_LINE) std::atomic<std::size_t> head{0};
+  std::size_t tail_cache = 0;
+  alignas(CACHE_LINE) alignas(T) unsigned char storage[Capacity * sizeof(T)];
+};